@@ -89,8 +89,24 @@ public:
         }
     }
 
+    /// Call after `bytes_written`. Coalesces the reader wakeups:
+    /// only the first write after the reader re-armed the flag needs one.
+    /// \returns true if the reader should be woken up
+    bool notify_reader() {
+        // acq_rel: the written data are visible to the reader which clears the flag
+        return !m_pending.exchange(true, std::memory_order_acq_rel);
+    }
+
     // reader - moves read_p, checks write_p
 
+    /// Re-arm the wakeup. Call before reading: any data written after this
+    /// will wake the reader again. Data not read after this call don't
+    /// cause another wakeup, the reader has to take care of them itself.
+    void rearm_reader() {
+        // acq_rel: the following reads see the data written before the flag was set
+        m_pending.exchange(false, std::memory_order_acq_rel);
+    }
+
     std::string_view read_buffer() const {
         // We're the only reader - R can't change, W may grow or cycle
         auto w = m_write_p.load(std::memory_order_acquire);
@@ -102,6 +118,18 @@ public:
         }
     }
 
+    /// Total number of bytes available for reading
+    /// (read_buffer() may return only the first part of it).
+    size_t read_size() const {
+        auto w = m_write_p.load(std::memory_order_acquire);
+        auto r = m_read_p.load(std::memory_order_relaxed);
+        if (r <= w)
+            return w - r;
+        return m_buffer.size() - r + w;
+    }
+
+    static constexpr size_t capacity() { return Size; }
+
     void bytes_read(size_t read) {
         auto r = m_read_p.load(std::memory_order_relaxed);
         if (r + read == m_buffer.size()) {
@@ -120,6 +148,7 @@ private:
     std::atomic<unsigned> m_read_p {0};
     std::binary_semaphore m_full_sem {0};
     std::atomic_bool m_full {false};
+    std::atomic_bool m_pending {false};  // the reader was notified and not re-armed yet
 };
 
 
@@ -0,0 +1,122 @@
+// ModeTracker.cpp created on 2026-10-19
+// This file is part of Termic project <https://github.com/rbrich/termic>
+// Copyright 2026 Radek Brich
+// Licensed under the Apache License, Version 2.0 (see LICENSE file)
+
+#include "ModeTracker.h"
+#include <fmt/format.h>
+#include <iterator>
+
+namespace xci::term {
+
+
+void ModeTracker::feed(std::string_view data)
+{
+    for (size_t i = 0; i != data.size(); ++i) {
+        const char c = data[i];
+        switch (m_state) {
+            case State::Normal: {
+                // Skip the text up to next ESC
+                const auto esc = data.find('\033', i);
+                if (esc == std::string_view::npos)
+                    return;
+                i = esc;
+                m_state = State::Escape;
+                break;
+            }
+            case State::Escape:
+                switch (c) {
+                    case '\033':
+                        break;
+                    case '[':
+                        m_params.clear();
+                        m_state = State::CSI;
+                        break;
+                    case ']':  // OSC
+                    case 'P':  // DCS
+                    case 'X':  // SOS
+                    case '^':  // PM
+                    case '_':  // APC
+                        m_state = State::String;
+                        break;
+                    default:
+                        m_state = State::Normal;
+                        break;
+                }
+                break;
+            case State::CSI:
+                if (c >= '0' && c <= '?') {
+                    m_params.feed(c);
+                    break;
+                }
+                if (!m_params.invalid())
+                    finish_csi(c);
+                m_state = State::Normal;
+                break;
+            case State::String:
+                // Terminated by BEL (OSC) or ST (ESC \), cancelled by CAN or SUB
+                if (c == '\033')
+                    m_state = State::Escape;
+                else if (c == 7 || c == 24 || c == 26)
+                    m_state = State::Normal;
+                break;
+        }
+    }
+}
+
+
+void ModeTracker::encode(std::string& out) const
+{
+    if (m_alternate_screen)
+        out += "\033[?1049h";
+    if (m_app_cursor_keys)
+        out += "\033[?1h";
+    if (!m_autowrap)
+        out += "\033[?7l";
+    if (m_mouse_tracking != 0)
+        fmt::format_to(std::back_inserter(out), "\033[?{}h", m_mouse_tracking);
+    if (m_mouse_sgr)
+        out += "\033[?1006h";
+    if (m_bracketed_paste)
+        out += "\033[?2004h";
+    if (m_insert)
+        out += "\033[4h";
+    if (m_attrs != sgr_default)
+        encode_sgr(out, m_attrs);
+}
+
+
+void ModeTracker::finish_csi(char f)
+{
+    if (m_params.marker() == '?' && (f == 'h' || f == 'l')) {
+        for (unsigned i = 0; i < m_params.size(); ++i)
+            set_private_mode(m_params.get(i, 0), f == 'h');
+        return;
+    }
+    if (m_params.marker() != 0)
+        return;
+    if (f == 'm')
+        apply_sgr(m_attrs, m_params, nullptr);
+    else if ((f == 'h' || f == 'l') && m_params.get(0, 0) == 4)
+        m_insert = f == 'h';
+}
+
+
+void ModeTracker::set_private_mode(unsigned mode, bool mode_set)
+{
+    switch (mode) {
+        case 1: m_app_cursor_keys = mode_set; break;
+        case 7: m_autowrap = mode_set; break;
+        case 47:
+        case 1049: m_alternate_screen = mode_set; break;
+        case 1000:
+        case 1002:
+        case 1003: m_mouse_tracking = mode_set ? uint16_t(mode) : 0; break;
+        case 1006: m_mouse_sgr = mode_set; break;
+        case 2004: m_bracketed_paste = mode_set; break;
+        default: break;
+    }
+}
+
+
+} // namespace xci::term
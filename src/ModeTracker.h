@@ -0,0 +1,57 @@
+// ModeTracker.h created on 2026-10-19
+// This file is part of Termic project <https://github.com/rbrich/termic>
+// Copyright 2026 Radek Brich
+// Licensed under the Apache License, Version 2.0 (see LICENSE file)
+
+#ifndef XCITERM_MODETRACKER_H
+#define XCITERM_MODETRACKER_H
+
+#include "SgrAttributes.h"
+#include "utility.h"
+#include <string>
+#include <string_view>
+#include <cstdint>
+
+namespace xci::term {
+
+
+/// Terminal modes and graphic rendition set by the output, tracked without
+/// decoding the text. Only the state which Terminal supports is tracked:
+/// - DECSET 1 (application cursor keys), 7 (autowrap),
+///   47 / 1049 (alternate screen), 1000 / 1002 / 1003 (mouse tracking),
+///   1006 (SGR mouse), 2004 (bracketed paste)
+/// - SM 4 (insert mode)
+/// - SGR attributes
+///
+/// MuxServer keeps only the recent output for replay. The output dropped
+/// from the replay is fed here, and the replay is prefixed by `encode`,
+/// so a client attaching to a long-running vim or less gets the modes right.
+class ModeTracker {
+public:
+    void feed(std::string_view data);
+
+    /// Append sequences which set the tracked state on a newly reset terminal
+    void encode(std::string& out) const;
+
+private:
+    void finish_csi(char f);
+    void set_private_mode(unsigned mode, bool mode_set);
+
+    enum class State: uint8_t { Normal, Escape, CSI, String };
+    State m_state = State::Normal;
+    CseqParams m_params;
+
+    SgrAttributes m_attrs = sgr_default;
+    uint16_t m_mouse_tracking = 0;  // 1000, 1002, 1003 or 0 = off
+    bool m_app_cursor_keys = false;
+    bool m_autowrap = true;
+    bool m_alternate_screen = false;
+    bool m_mouse_sgr = false;
+    bool m_bracketed_paste = false;
+    bool m_insert = false;
+};
+
+
+} // namespace xci::term
+
+#endif // XCITERM_MODETRACKER_H
@@ -0,0 +1,93 @@
+// MouseReporter.cpp created on 2026-10-19
+// This file is part of Termic project <https://github.com/rbrich/termic>
+// Copyright 2026 Radek Brich
+// Licensed under the Apache License, Version 2.0 (see LICENSE file)
+
+#include "MouseReporter.h"
+#include <fmt/format.h>
+#include <iterator>
+
+namespace xci::term {
+
+
+void MouseReporter::set_tracking(Tracking tracking)
+{
+    m_tracking = tracking;
+    m_buttons = 0;
+    m_motion_pending = false;
+    m_reported = {-1, -1};
+}
+
+
+void MouseReporter::button(Button button, bool press, Pos pos)
+{
+    if (m_tracking == Tracking::Off)
+        return;
+    const auto cb = unsigned(button);
+    const bool wheel = cb >= 64;
+    if (press && m_out.size() >= max_pending)
+        return;  // the application doesn't read them
+    if (!wheel) {
+        if (press)
+            m_buttons |= uint8_t(1u << cb);
+        else if (m_buttons & (1u << cb))
+            m_buttons &= uint8_t(~(1u << cb));
+        else
+            return;  // pressed before the tracking was enabled
+    } else if (!press)
+        return;  // wheel has no release
+    // The button report has its own position, the motion before it is redundant
+    m_motion_pending = false;
+    m_reported = pos;
+    // X10 encoding has no button number for release
+    encode(press || m_sgr ? cb : 3, pos, !press);
+}
+
+
+void MouseReporter::motion(Pos pos)
+{
+    if (m_tracking == Tracking::Motion
+    || (m_tracking == Tracking::Drag && m_buttons != 0)) {
+        m_motion = pos;
+        m_motion_pending = pos != m_reported;
+    }
+}
+
+
+std::string_view MouseReporter::pending()
+{
+    if (m_motion_pending) {
+        m_motion_pending = false;
+        m_reported = m_motion;
+        // The lowest held button, 3 = none
+        unsigned cb = 3;
+        for (unsigned b = 0; b != 3; ++b) {
+            if (m_buttons & (1u << b)) {
+                cb = b;
+                break;
+            }
+        }
+        encode(cb + 32, m_motion, false);
+    }
+    return m_out;
+}
+
+
+void MouseReporter::encode(unsigned cb, Pos pos, bool release)
+{
+    if (m_sgr) {
+        fmt::format_to(std::back_inserter(m_out), "\033[<{};{};{}{}",
+                       cb, pos.x + 1, pos.y + 1, release ? 'm' : 'M');
+        return;
+    }
+    // The coordinates are single bytes, offset by 32 (and 1-based)
+    if (pos.x > 222 || pos.y > 222)
+        return;
+    m_out += "\033[M";
+    m_out += char(32 + cb);
+    m_out += char(33 + pos.x);
+    m_out += char(33 + pos.y);
+}
+
+
+} // namespace xci::term
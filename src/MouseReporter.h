@@ -0,0 +1,66 @@
+// MouseReporter.h created on 2026-10-19
+// This file is part of Termic project <https://github.com/rbrich/termic>
+// Copyright 2026 Radek Brich
+// Licensed under the Apache License, Version 2.0 (see LICENSE file)
+
+#ifndef XCITERM_MOUSEREPORTER_H
+#define XCITERM_MOUSEREPORTER_H
+
+#include <xci/core/geometry.h>
+#include <string>
+#include <string_view>
+#include <cstdint>
+
+namespace xci::term {
+
+
+/// Mouse reports for the application (xterm mouse tracking)
+///
+/// Tracking modes (DECSET):
+/// - 1000: button press and release
+/// - 1002: also motion while a button is held
+/// - 1003: also motion without a button
+///
+/// Encoding is `CSI M Cb Cx Cy` (X10 compatible, coordinates up to 223),
+/// or `CSI < b ; x ; y M` / `m` with DECSET 1006 (SGR).
+///
+/// Reports are appended to a reusable buffer, the owner writes out `pending()`
+/// and then calls `clear()`. Motion is coalesced: only the last position
+/// is kept until then, and it's reported only if it's in another cell
+/// than the last report. When the application doesn't read the reports
+/// and `max_pending` is reached, new presses and wheel steps are dropped.
+/// The release of a held button is still reported.
+class MouseReporter {
+public:
+    enum class Tracking: uint8_t { Off, Buttons, Drag, Motion };
+    enum class Button: uint8_t { Left = 0, Middle = 1, Right = 2, WheelUp = 64, WheelDown = 65 };
+    using Pos = core::Vec2i;  // cell, zero-based
+    static constexpr size_t max_pending = 4096;  // bytes
+
+    void set_tracking(Tracking tracking);
+    void set_sgr(bool sgr) { m_sgr = sgr; }
+    bool enabled() const { return m_tracking != Tracking::Off; }
+
+    void button(Button button, bool press, Pos pos);
+    void motion(Pos pos);
+
+    /// Reports to be written, including the coalesced motion.
+    std::string_view pending();
+    void clear() { m_out.clear(); }
+
+private:
+    void encode(unsigned cb, Pos pos, bool release);
+
+    std::string m_out;
+    Tracking m_tracking = Tracking::Off;
+    bool m_sgr = false;
+    bool m_motion_pending = false;
+    uint8_t m_buttons = 0;  // held buttons, bit (1 << Button)
+    Pos m_motion;
+    Pos m_reported {-1, -1};  // cell of the last report
+};
+
+
+} // namespace xci::term
+
+#endif // XCITERM_MOUSEREPORTER_H
@@ -0,0 +1,408 @@
+// MuxServer.cpp created on 2026-10-19
+// This file is part of Termic project <https://github.com/rbrich/termic>
+// Copyright 2026 Radek Brich
+// Licensed under the Apache License, Version 2.0 (see LICENSE file)
+
+#include "MuxServer.h"
+#include <xci/core/log.h>
+#include <fmt/core.h>
+
+#include <algorithm>
+#include <array>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/un.h>
+
+using namespace xci::core;
+
+namespace xci::term {
+
+
+MuxServer::~MuxServer()
+{
+    for (auto& client : m_clients)
+        ::close(client.fd);
+    if (m_listen_fd != -1) {
+        ::close(m_listen_fd);
+        ::unlink(m_socket_path.c_str());
+    }
+}
+
+
+bool MuxServer::start(const std::string& socket_path)
+{
+    sockaddr_un addr = {};
+    addr.sun_family = AF_UNIX;
+    if (socket_path.size() >= sizeof(addr.sun_path)) {
+        log::error("MuxServer: socket path too long: {}", socket_path);
+        return false;
+    }
+    std::memcpy(addr.sun_path, socket_path.c_str(), socket_path.size() + 1);
+    if (!mux::check_socket_dir(socket_path, /*create=*/true))
+        return false;
+
+    m_listen_fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (m_listen_fd == -1) {
+        log::error("MuxServer: socket: {m}");
+        return false;
+    }
+    ::fcntl(m_listen_fd, F_SETFD, FD_CLOEXEC);
+
+    // Remove stale socket, but don't steal it from a running server
+    if (::connect(m_listen_fd, (sockaddr*) &addr, sizeof(addr)) == 0) {
+        log::error("MuxServer: already running at {}", socket_path);
+        ::close(m_listen_fd);
+        m_listen_fd = -1;
+        return false;
+    }
+    ::close(m_listen_fd);
+    ::unlink(socket_path.c_str());
+    m_listen_fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    ::fcntl(m_listen_fd, F_SETFD, FD_CLOEXEC);
+
+    const auto old_umask = ::umask(0077);  // only the owner can attach
+    const int rc = ::bind(m_listen_fd, (sockaddr*) &addr, sizeof(addr));
+    ::umask(old_umask);
+    if (rc == -1 || ::listen(m_listen_fd, 4) == -1) {
+        log::error("MuxServer: bind/listen {}: {m}", socket_path);
+        ::close(m_listen_fd);
+        m_listen_fd = -1;
+        return false;
+    }
+    m_socket_path = socket_path;
+
+    if (!m_shell.start())
+        return false;
+    log::info("MuxServer: listening on {}", socket_path);
+    return true;
+}
+
+
+void MuxServer::run()
+{
+    std::vector<pollfd> fds;
+    std::array<char, 64 * 1024> buffer;
+    for (;;) {
+        // 0 = PTY, 1 = shell exit (pidfd), 2 = listen, 3.. = clients
+        // (fd -1 is ignored by poll - the PTY isn't read while some client is behind)
+        const int timeout = check_backlog();
+        fds.clear();
+        fds.push_back({timeout != -1 ? -1 : m_shell.fileno(), POLLIN, 0});
+        fds.push_back({m_shell.pidfd(), POLLIN, 0});
+        fds.push_back({m_listen_fd, POLLIN, 0});
+        for (const auto& client : m_clients) {
+            const bool pending = client.out.size() != client.out_sent;
+            fds.push_back({client.fd, short(POLLIN | (pending ? POLLOUT : 0)), 0});
+        }
+
+        if (::poll(fds.data(), fds.size(), timeout) == -1) {
+            if (errno == EINTR)
+                continue;
+            log::error("MuxServer: poll: {m}");
+            return;
+        }
+
+        if (fds[0].revents != 0) {
+            auto nread = m_shell.read(buffer.data(), buffer.size());
+            if (nread <= 0)
+                break;  // EOF or error
+            send_output({buffer.data(), size_t(nread)});
+        }
+        if (fds[1].revents != 0) {
+            // Pass the remaining output, then leave
+            pollfd pty = {m_shell.fileno(), POLLIN, 0};
+            while (::poll(&pty, 1, 0) == 1 && (pty.revents & POLLIN)) {
+                auto nread = m_shell.read(buffer.data(), buffer.size());
+                if (nread <= 0)
+                    break;
+                send_output({buffer.data(), size_t(nread)});
+            }
+            break;
+        }
+        for (size_t k = 3; k != fds.size(); ++k) {
+            if (fds[k].revents == 0)
+                continue;
+            // Look up by fd, the clients may have been reordered by drop_client
+            auto it = std::find_if(m_clients.begin(), m_clients.end(),
+                                   [fd = fds[k].fd](const Client& c) { return c.fd == fd; });
+            if (it == m_clients.end())
+                continue;
+            const auto i = size_t(it - m_clients.begin());
+            if (((fds[k].revents & POLLOUT) && !flush_client(i))
+            || ((fds[k].revents & ~POLLOUT) && !read_client(i)))
+                drop_client(i);
+        }
+        if (fds[2].revents != 0)
+            accept_client();
+    }
+    flush_all();
+    m_shell.reap();
+    log::info("MuxServer: shell closed, exiting");
+}
+
+
+void MuxServer::accept_client()
+{
+    int fd = ::accept(m_listen_fd, nullptr, nullptr);
+    if (fd == -1) {
+        log::error("MuxServer: accept: {m}");
+        return;
+    }
+    ::fcntl(fd, F_SETFD, FD_CLOEXEC);
+    if (!mux::check_peer(fd)) {
+        ::close(fd);
+        return;
+    }
+    if (m_clients.size() >= max_clients) {
+        log::warning("MuxServer: too many clients");
+        ::close(fd);
+        return;
+    }
+
+    // Queue the size of the replay and the replay itself, they are sent in the loop
+    ::fcntl(fd, F_SETFL, ::fcntl(fd, F_GETFL) | O_NONBLOCK);
+    auto& client = m_clients.emplace_back();
+    client.fd = fd;
+    client.out.assign(4, '\0');
+    m_history_modes.encode(client.out);
+    client.out.append(m_history);
+    const auto replay = uint32_t(client.out.size() - 4);
+    for (unsigned b = 0; b != 4; ++b)
+        client.out[b] = char((replay >> (8 * b)) & 0xff);
+    if (m_reply_fd == -1)
+        m_reply_fd = fd;
+    log::info("MuxServer: client attached ({} total)", m_clients.size());
+}
+
+
+bool MuxServer::read_client(size_t i)
+{
+    auto& client = m_clients[i];
+    char buffer[4096];
+    auto n = ::read(client.fd, buffer, sizeof(buffer));
+    if (n == -1 && (errno == EAGAIN || errno == EINTR))
+        return true;
+    if (n <= 0)
+        return false;
+    client.in.append(buffer, size_t(n));
+
+    // Process complete messages
+    std::string_view in = client.in;
+    while (in.size() >= mux::header_size) {
+        const auto type = mux::Message(in[0]);
+        const size_t len = size_t(uint8_t(in[1])) | size_t(uint8_t(in[2])) << 8;
+        if (in.size() < mux::header_size + len)
+            break;
+        const auto payload = in.substr(mux::header_size, len);
+        switch (type) {
+            case mux::Message::Input:
+                m_shell.write(payload);
+                break;
+            case mux::Message::Reply:
+                // The other clients would reply to the same query again
+                if (client.fd == m_reply_fd)
+                    m_shell.write(payload);
+                break;
+            case mux::Message::Resize:
+                if (len != 4)
+                    return false;
+                m_shell.set_winsize({
+                        unsigned(uint8_t(payload[0])) | unsigned(uint8_t(payload[1])) << 8,
+                        unsigned(uint8_t(payload[2])) | unsigned(uint8_t(payload[3])) << 8});
+                break;
+            default:
+                log::warning("MuxServer: unknown message {}", int(type));
+                return false;
+        }
+        in.remove_prefix(mux::header_size + len);
+    }
+    client.in.erase(0, client.in.size() - in.size());
+    return true;
+}
+
+
+void MuxServer::send_output(std::string_view data)
+{
+    // Keep the recent output for newly attached clients.
+    // Trim at line boundary, so the replay doesn't start in middle of a sequence.
+    // The modes set by the trimmed part are tracked, they are replayed too.
+    m_history.append(data);
+    if (m_history.size() > history_size) {
+        auto cut = m_history.find('\n', m_history.size() - history_size * 3 / 4);
+        cut = cut == std::string::npos ? m_history.size() : cut + 1;
+        m_history_modes.feed(std::string_view(m_history).substr(0, cut));
+        m_history.erase(0, cut);
+    }
+
+    for (size_t i = m_clients.size(); i != 0; --i) {
+        m_clients[i - 1].out.append(data);
+        if (!flush_client(i - 1))
+            drop_client(i - 1);
+    }
+}
+
+
+bool MuxServer::flush_client(size_t i)
+{
+    auto& client = m_clients[i];
+    while (client.out_sent != client.out.size()) {
+        // A client may disconnect while we're writing to it, don't get SIGPIPE
+        auto n = ::send(client.fd, client.out.data() + client.out_sent,
+                        client.out.size() - client.out_sent, MSG_NOSIGNAL);
+        if (n == -1) {
+            if (errno == EINTR)
+                continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+                break;  // the rest is sent on POLLOUT
+            log::warning("MuxServer: send: {m}");
+            return false;
+        }
+        client.out_sent += size_t(n);
+    }
+    if (client.out_sent == client.out.size()) {
+        client.out.clear();
+        client.out_sent = 0;
+    } else if (client.out_sent >= max_backlog) {
+        // Drop the sent part, without moving the rest on each partial send
+        client.out.erase(0, client.out_sent);
+        client.out_sent = 0;
+    }
+    return true;
+}
+
+
+void MuxServer::flush_all()
+{
+    // The shell has exited - give each client limited time to receive the rest
+    for (auto& client : m_clients) {
+        ::fcntl(client.fd, F_SETFL, ::fcntl(client.fd, F_GETFL) & ~O_NONBLOCK);
+        timeval timeout = {1, 0};
+        ::setsockopt(client.fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+    }
+    for (size_t i = m_clients.size(); i != 0; --i)
+        flush_client(i - 1);
+}
+
+
+int MuxServer::check_backlog()
+{
+    // Drop the clients which are behind for too long.
+    // Returns poll timeout until the nearest deadline, or -1 if no client is behind.
+    const auto now = Clock::now();
+    int timeout = -1;
+    for (size_t i = m_clients.size(); i != 0; --i) {
+        auto& client = m_clients[i - 1];
+        if (client.out.size() - client.out_sent <= max_backlog) {
+            client.stalled = {};
+            continue;
+        }
+        if (client.stalled == Clock::time_point{})
+            client.stalled = now;
+        const auto left = client.stalled + max_stall - now;
+        if (left <= Clock::duration::zero()) {
+            log::warning("MuxServer: client not receiving for {}s, disconnecting",
+                         max_stall.count());
+            drop_client(i - 1);
+            continue;
+        }
+        const int ms = int(std::chrono::ceil<std::chrono::milliseconds>(left).count());
+        timeout = timeout == -1 ? ms : std::min(timeout, ms);
+    }
+    return timeout;
+}
+
+
+void MuxServer::drop_client(size_t i)
+{
+    ::close(m_clients[i].fd);
+    const bool replying = m_clients[i].fd == m_reply_fd;
+    m_clients[i] = std::move(m_clients.back());
+    m_clients.pop_back();
+    if (replying)
+        m_reply_fd = m_clients.empty() ? -1 : m_clients.front().fd;
+    log::info("MuxServer: client detached ({} left)", m_clients.size());
+}
+
+
+namespace mux {
+
+std::string default_socket_path()
+{
+    if (const char* dir = std::getenv("XDG_RUNTIME_DIR"); dir && *dir)
+        return fmt::format("{}/termic/termic.sock", dir);
+    return fmt::format("/tmp/termic-{}/termic.sock", ::getuid());
+}
+
+
+bool check_socket_dir(const std::string& socket_path, bool create)
+{
+    const auto slash = socket_path.rfind('/');
+    const std::string dir = slash == std::string::npos ? "."
+                          : slash == 0 ? "/" : socket_path.substr(0, slash);
+    if (create && ::mkdir(dir.c_str(), 0700) == -1 && errno != EEXIST) {
+        log::error("mkdir {}: {m}", dir);
+        return false;
+    }
+    // lstat - don't follow a symlink planted by someone else
+    struct stat st;
+    if (::lstat(dir.c_str(), &st) == -1) {
+        log::error("stat {}: {m}", dir);
+        return false;
+    }
+    if (!S_ISDIR(st.st_mode) || st.st_uid != ::getuid() || (st.st_mode & 077) != 0) {
+        log::error("Socket directory {} must be owned by current user, with mode 0700", dir);
+        return false;
+    }
+    return true;
+}
+
+
+bool check_peer(int fd)
+{
+#ifdef SO_PEERCRED
+    ucred cred = {};
+    socklen_t len = sizeof(cred);
+    if (::getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &cred, &len) == -1) {
+        log::error("getsockopt(SO_PEERCRED): {m}");
+        return false;
+    }
+    const uid_t uid = cred.uid;
+#else
+    uid_t uid;
+    gid_t gid;
+    if (::getpeereid(fd, &uid, &gid) == -1) {
+        log::error("getpeereid: {m}");
+        return false;
+    }
+#endif
+    if (uid != ::getuid()) {
+        log::error("Socket peer is another user (uid {}), refusing", uid);
+        return false;
+    }
+    return true;
+}
+
+
+void encode(std::string& out, Message type, std::string_view payload)
+{
+    // Long input is split to multiple messages
+    do {
+        const auto len = std::min(payload.size(), max_payload);
+        out += char(type);
+        out += char(len & 0xff);
+        out += char(len >> 8);
+        out.append(payload.substr(0, len));
+        payload.remove_prefix(len);
+    } while (!payload.empty());
+}
+
+} // namespace mux
+
+
+} // namespace xci::term
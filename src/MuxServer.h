@@ -0,0 +1,119 @@
+// MuxServer.h created on 2026-10-19
+// This file is part of Termic project <https://github.com/rbrich/termic>
+// Copyright 2026 Radek Brich
+// Licensed under the Apache License, Version 2.0 (see LICENSE file)
+
+#ifndef XCITERM_MUXSERVER_H
+#define XCITERM_MUXSERVER_H
+
+#include "Shell.h"
+#include "ModeTracker.h"
+#include <string>
+#include <string_view>
+#include <vector>
+#include <chrono>
+#include <cstdint>
+
+namespace xci::term {
+
+
+/// Session server (`termic --server`)
+///
+/// Owns the shell session, GUI instances attach to it over Unix domain socket
+/// (`termic --attach`, see `Shell::attach`). The session survives
+/// GUI crashes and multiple viewers can attach at once.
+///
+/// Protocol:
+/// - server -> client: size of the replayed output (uint32, little-endian),
+///   the replayed output, then raw output of the shell (as read from PTY).
+///   The replay is the recent output (up to `history_size`), prefixed by
+///   the modes and attributes set by the older output (see `ModeTracker`).
+/// - client -> server: messages, 1 byte type, 2 bytes payload length
+///   (little-endian), then the payload (see `mux::Message`)
+///
+/// Each client decodes the output with its own Terminal, which answers
+/// the queries (e.g. DA). Only the replies of one client go to the shell,
+/// the one attached longest. The client doesn't reply to the queries
+/// in the replayed output, they were already answered.
+///
+/// The output for each client is queued and sent when the client can receive it.
+/// When some client is more than `max_backlog` behind, the server stops reading
+/// the PTY, until the client catches up - the shell waits, like with a slow
+/// local terminal. A client which doesn't catch up within `max_stall`
+/// (e.g. stopped or hung) is disconnected, so it doesn't block the others.
+class MuxServer {
+public:
+    static constexpr size_t history_size = 1024 * 1024;
+    static constexpr size_t max_clients = 16;
+    static constexpr size_t max_backlog = 256 * 1024;
+    static constexpr auto max_stall = std::chrono::seconds(5);
+
+    ~MuxServer();
+
+    /// Start the shell and listen on the socket
+    bool start(const std::string& socket_path);
+
+    /// Serve until the shell exits
+    void run();
+
+private:
+    void accept_client();
+    bool read_client(size_t i);
+    void send_output(std::string_view data);
+    bool flush_client(size_t i);
+    void flush_all();
+    int check_backlog();
+    void drop_client(size_t i);
+
+    using Clock = std::chrono::steady_clock;
+
+    struct Client {
+        int fd = -1;
+        std::string in;  // partially received message
+        std::string out;  // output not yet sent
+        size_t out_sent = 0;  // the part of `out` which was already sent
+        Clock::time_point stalled {};  // since when the client is over `max_backlog`
+    };
+
+    Shell m_shell;
+    std::string m_socket_path;
+    int m_listen_fd = -1;
+    std::vector<Client> m_clients;
+    int m_reply_fd = -1;  // the client whose replies go to the shell
+    std::string m_history;
+    ModeTracker m_history_modes;  // the state at the beginning of `m_history`
+};
+
+
+namespace mux {
+
+enum class Message: uint8_t {
+    Input = 'i',    // payload: bytes for the shell
+    Reply = 'q',    // payload: reply to a query (e.g. DA), for the shell
+    Resize = 'r',   // payload: columns, rows (2x uint16, little-endian)
+};
+
+static constexpr size_t header_size = 3;
+static constexpr size_t max_payload = 65535;
+
+/// Default socket path: $XDG_RUNTIME_DIR/termic/termic.sock
+/// or /tmp/termic-<uid>/termic.sock
+std::string default_socket_path();
+
+/// Check that the directory of the socket is private: owned by current user,
+/// no access for others. Otherwise another user could put his own socket there.
+/// \param create  create the directory (mode 0700) if it doesn't exist
+bool check_socket_dir(const std::string& socket_path, bool create);
+
+/// Check that the other end of the Unix socket is a process of current user
+bool check_peer(int fd);
+
+/// Append a framed message to `out`
+void encode(std::string& out, Message type, std::string_view payload);
+
+} // namespace mux
+
+
+} // namespace xci::term
+
+#endif // XCITERM_MUXSERVER_H
@@ -0,0 +1,149 @@
+// OscParser.cpp created on 2026-10-19
+// This file is part of Termic project <https://github.com/rbrich/termic>
+// Copyright 2026 Radek Brich
+// Licensed under the Apache License, Version 2.0 (see LICENSE file)
+
+#include "OscParser.h"
+#include <algorithm>
+
+namespace xci::term {
+
+
+void OscParser::clear()
+{
+    // Don't keep a huge buffer after a big clipboard write
+    if (m_payload.capacity() > max_hyperlink) {
+        std::string payload;
+        payload.reserve(max_title);
+        m_payload.swap(payload);
+    }
+    m_payload.clear();
+    m_number = 0;
+    m_b64_bits = 0;
+    m_b64_count = 0;
+    m_state = State::Number;
+    m_command = Command::None;
+    m_overflow = false;
+    m_invalid = false;
+    m_clipboard_query = false;
+    m_b64_end = false;
+}
+
+
+void OscParser::feed(char c)
+{
+    // C0 controls other than the terminators are ignored
+    if (c >= 0 && c < ' ')
+        return;
+
+    switch (m_state) {
+        case State::Number:
+            if (c >= '0' && c <= '9') {
+                m_number = std::min(m_number * 10 + unsigned(c - '0'), 65535u);
+                break;
+            }
+            if (c != ';') {
+                m_command = Command::Unknown;
+                m_state = State::Skip;
+                break;
+            }
+            switch (m_number) {
+                case 0:  // icon name and window title
+                case 2:  // window title
+                    m_command = Command::Title;
+                    m_state = State::Data;
+                    break;
+                case 8:
+                    m_command = Command::Hyperlink;
+                    m_state = State::Data;
+                    break;
+                case 52:
+                    m_command = Command::Clipboard;
+                    m_state = State::ClipboardTarget;
+                    break;
+                default:
+                    m_command = Command::Unknown;
+                    m_state = State::Skip;
+                    break;
+            }
+            break;
+
+        case State::Data:
+            append(c, m_command == Command::Title ? max_title : max_hyperlink);
+            break;
+
+        case State::ClipboardTarget:
+            if (c == ';')
+                m_state = State::ClipboardData;
+            break;
+
+        case State::ClipboardData:
+            if (c == '?' && m_payload.empty() && m_b64_count == 0)
+                m_clipboard_query = true;
+            else
+                feed_base64(c);
+            break;
+
+        case State::Skip:
+            break;
+    }
+}
+
+
+std::string_view OscParser::hyperlink_uri() const
+{
+    auto sep = m_payload.find(';');
+    if (sep == std::string::npos)
+        return {};
+    return std::string_view(m_payload).substr(sep + 1);
+}
+
+
+void OscParser::append(char c, size_t limit)
+{
+    if (m_overflow)
+        return;
+    if (m_payload.size() >= limit) {
+        m_overflow = true;
+        m_payload.clear();
+        return;
+    }
+    m_payload += c;
+}
+
+
+void OscParser::feed_base64(char c)
+{
+    unsigned v;
+    if (c >= 'A' && c <= 'Z') v = unsigned(c - 'A');
+    else if (c >= 'a' && c <= 'z') v = unsigned(c - 'a') + 26;
+    else if (c >= '0' && c <= '9') v = unsigned(c - '0') + 52;
+    else if (c == '+') v = 62;
+    else if (c == '/') v = 63;
+    else if (c == '=') {
+        m_b64_end = true;  // padding - the remaining bits are complete bytes
+        return;
+    } else {
+        m_invalid = true;
+        return;
+    }
+    if (m_b64_end) {
+        m_invalid = true;  // data after padding
+        return;
+    }
+    m_b64_bits = (m_b64_bits << 6) | v;
+    // emit each byte as soon as its bits are complete (the padded end may follow)
+    switch (++m_b64_count) {
+        case 2: append(char(m_b64_bits >> 4), max_clipboard); break;
+        case 3: append(char(m_b64_bits >> 2), max_clipboard); break;
+        case 4:
+            append(char(m_b64_bits), max_clipboard);
+            m_b64_bits = 0;
+            m_b64_count = 0;
+            break;
+        default: break;
+    }
+}
+
+
+} // namespace xci::term
@@ -0,0 +1,93 @@
+// OscParser.h created on 2026-10-19
+// This file is part of Termic project <https://github.com/rbrich/termic>
+// Copyright 2026 Radek Brich
+// Licensed under the Apache License, Version 2.0 (see LICENSE file)
+
+#ifndef XCITERM_OSCPARSER_H
+#define XCITERM_OSCPARSER_H
+
+#include <string>
+#include <string_view>
+#include <cstdint>
+#include <cstddef>
+
+namespace xci::term {
+
+
+/// Streaming parser of OSC control string: "ESC ] Ps ; Pt ST"
+///
+/// The bytes of Ps ; Pt are fed one by one (the terminator is handled
+/// by the caller). Only the supported commands keep their payload,
+/// each up to its size limit, so the memory stays bounded whatever the input.
+/// A longer payload is dropped and the overflow is flagged.
+///
+/// Supported commands:
+/// - OSC 0, 2 - window title, payload is the title
+/// - OSC 8 - hyperlink, payload is "params;URI"
+/// - OSC 52 - clipboard, payload is the decoded data (Base64 is decoded on the fly)
+class OscParser {
+public:
+    enum class Command: uint8_t {
+        None,       // Ps not finished yet (no ';')
+        Title,
+        Hyperlink,
+        Clipboard,
+        Unknown,    // not supported, the payload is skipped
+    };
+
+    static constexpr size_t max_title = 1024;
+    static constexpr size_t max_hyperlink = 4096;
+    static constexpr size_t max_clipboard = 1024 * 1024;  // decoded bytes
+
+    OscParser() { m_payload.reserve(max_title); }
+
+    /// Reset state for next control string.
+    void clear();
+
+    /// Parse next byte of the control string
+    void feed(char c);
+
+    Command command() const { return m_command; }
+    unsigned number() const { return m_number; }
+    std::string_view payload() const { return m_payload; }
+
+    /// The payload was too long and was dropped
+    bool overflow() const { return m_overflow; }
+
+    /// The payload is malformed (e.g. bad Base64 in OSC 52)
+    bool invalid() const { return m_invalid; }
+
+    /// OSC 52: the data is "?" (a query, not a Base64 string)
+    bool clipboard_query() const { return m_clipboard_query; }
+
+    /// OSC 8: URI, parsed from the payload (for debug log)
+    std::string_view hyperlink_uri() const;
+
+private:
+    enum class State: uint8_t {
+        Number,
+        Data,
+        ClipboardTarget,    // OSC 52 Pc (the selection, e.g. "c")
+        ClipboardData,      // OSC 52 Pd (Base64)
+        Skip,
+    };
+
+    void append(char c, size_t limit);
+    void feed_base64(char c);
+
+    std::string m_payload;
+    unsigned m_number = 0;
+    uint32_t m_b64_bits = 0;
+    uint8_t m_b64_count = 0;
+    State m_state = State::Number;
+    Command m_command = Command::None;
+    bool m_overflow : 1 = false;
+    bool m_invalid : 1 = false;
+    bool m_clipboard_query : 1 = false;
+    bool m_b64_end : 1 = false;
+};
+
+
+} // namespace xci::term
+
+#endif // XCITERM_OSCPARSER_H
@@ -0,0 +1,176 @@
+// PerfStats.cpp created on 2026-10-19
+// This file is part of Termic project <https://github.com/rbrich/termic>
+// Copyright 2026 Radek Brich
+// Licensed under the Apache License, Version 2.0 (see LICENSE file)
+
+#include "PerfStats.h"
+#include <fmt/format.h>
+#include <algorithm>
+
+namespace xci::term {
+
+
+template <size_t N>
+double RollingSamples<N>::percentile(double q) const
+{
+    if (m_size == 0)
+        return 0.0;
+    auto sorted = m_samples;
+    auto end = sorted.begin() + m_size;  // the first m_size items are valid until wrapped
+    auto nth = sorted.begin() + size_t(q * double(m_size - 1) + 0.5);
+    std::nth_element(sorted.begin(), nth, end);
+    return *nth;
+}
+
+
+void PerfStats::add_frame(std::chrono::nanoseconds decode_time, double buffer_fill,
+                          const DecodeCounters& counters)
+{
+    using namespace std::chrono;
+    m_decode_us.add(double(duration_cast<microseconds>(decode_time).count()));
+    m_buffer_fill.add(buffer_fill * 100.0);
+    m_damaged_lines.add(double(counters.damaged_lines - m_last_frame_counters.damaged_lines));
+    m_last_frame_counters = counters;
+    m_counters = counters;
+}
+
+
+void PerfStats::update(Clock::time_point now)
+{
+    if (m_last_sample == Clock::time_point{}) {
+        m_last_sample = now;
+        return;
+    }
+    const auto elapsed = std::chrono::duration<double>(now - m_last_sample).count();
+    if (elapsed < 1.0)
+        return;
+    m_last_sample = now;
+
+    auto rate = [elapsed](uint64_t cur, uint64_t& last) {
+        auto r = double(cur - last) / elapsed;
+        last = cur;
+        return r;
+    };
+    m_pty_bytes_rate.add(rate(m_pty_bytes.load(std::memory_order_relaxed), m_last_pty_bytes));
+    m_pty_reads_rate.add(rate(m_pty_reads.load(std::memory_order_relaxed), m_last_pty_reads));
+    m_wakeups_rate.add(rate(m_wakeups.load(std::memory_order_relaxed), m_last_wakeups));
+    auto& c = m_counters;
+    auto& l = m_last_rate_counters;
+    m_text_rate.add(rate(c.text_bytes, l.text_bytes));
+    m_control_rate.add(rate(c.control, l.control));
+    m_escape_rate.add(rate(c.escape, l.escape));
+    m_csi_rate.add(rate(c.csi, l.csi));
+    m_osc_rate.add(rate(c.osc, l.osc));
+}
+
+
+void PerfStats::add_input_latency(std::chrono::nanoseconds latency)
+{
+    const auto ms = std::chrono::duration<double, std::milli>(latency).count();
+    m_input_latency.add(ms);
+    size_t bucket = 0;
+    while (bucket + 1 < latency_buckets && ms >= double(1u << bucket))
+        ++bucket;
+    ++m_latency_hist[bucket];
+}
+
+
+template <size_t N>
+auto PerfStats::make_value(const RollingSamples<N>& s) -> Value
+{
+    return {s.last(), s.percentile(0.5), s.percentile(0.95), s.percentile(0.99)};
+}
+
+
+auto PerfStats::snapshot() const -> Snapshot
+{
+    return {
+        .pty_bytes_per_s = make_value(m_pty_bytes_rate),
+        .pty_reads_per_s = make_value(m_pty_reads_rate),
+        .wakeups_per_s = make_value(m_wakeups_rate),
+        .decode_us_per_frame = make_value(m_decode_us),
+        .buffer_fill_pct = make_value(m_buffer_fill),
+        .damaged_lines_per_frame = make_value(m_damaged_lines),
+        .text_bytes_per_s = make_value(m_text_rate),
+        .control_per_s = make_value(m_control_rate),
+        .escape_per_s = make_value(m_escape_rate),
+        .csi_per_s = make_value(m_csi_rate),
+        .osc_per_s = make_value(m_osc_rate),
+        .input_latency_ms = make_value(m_input_latency),
+    };
+}
+
+
+std::string PerfStats::format() const
+{
+    const auto s = snapshot();
+    std::string out = "                last     p50     p95     p99\n";
+    auto line = [&out](const char* name, const Value& v) {
+        out += fmt::format("{:<12} {:>7.0f} {:>7.0f} {:>7.0f} {:>7.0f}\n",
+                           name, v.last, v.p50, v.p95, v.p99);
+    };
+    line("PTY kB/s", {s.pty_bytes_per_s.last / 1024, s.pty_bytes_per_s.p50 / 1024,
+                      s.pty_bytes_per_s.p95 / 1024, s.pty_bytes_per_s.p99 / 1024});
+    line("PTY reads/s", s.pty_reads_per_s);
+    line("wakeups/s", s.wakeups_per_s);
+    line("decode us", s.decode_us_per_frame);
+    line("buffer %", s.buffer_fill_pct);
+    line("damaged ln", s.damaged_lines_per_frame);
+    line("text B/s", s.text_bytes_per_s);
+    line("ctl/s", s.control_per_s);
+    line("ESC/s", s.escape_per_s);
+    line("CSI/s", s.csi_per_s);
+    line("OSC/s", s.osc_per_s);
+    out += fmt::format("{:<12} {:>7.1f} {:>7.1f} {:>7.1f} {:>7.1f}\n", "latency ms",
+                       s.input_latency_ms.last, s.input_latency_ms.p50,
+                       s.input_latency_ms.p95, s.input_latency_ms.p99);
+    return out;
+}
+
+
+std::string PerfStats::format_latency_histogram() const
+{
+    uint64_t total = 0;
+    for (auto n : m_latency_hist)
+        total += n;
+    if (total == 0)
+        return "no input latency samples\n";
+    std::string out;
+    for (size_t i = 0; i != latency_buckets; ++i) {
+        const auto lo = i == 0 ? 0u : 1u << (i - 1);
+        const auto label = i + 1 == latency_buckets
+                ? fmt::format(">= {} ms", lo)
+                : fmt::format("{}-{} ms", lo, 1u << i);
+        const auto n = m_latency_hist[i];
+        out += fmt::format("{:>12} {:>8} {:<50}\n", label, n,
+                           std::string(size_t(50 * n / total), '#'));
+    }
+    return out;
+}
+
+
+void StartupTimer::phase(const char* name)
+{
+    const auto now = Clock::now();
+    if (m_num_phases != max_phases)
+        m_phases[m_num_phases++] = {name, now - m_last};
+    m_last = now;
+}
+
+
+std::string StartupTimer::format() const
+{
+    using namespace std::chrono;
+    std::string out;
+    for (size_t i = 0; i != m_num_phases; ++i) {
+        const auto& p = m_phases[i];
+        out += fmt::format("{:<14} {:>8.1f} ms\n", p.name,
+                           duration<double, std::milli>(p.duration).count());
+    }
+    out += fmt::format("{:<14} {:>8.1f} ms\n", "total",
+                       duration<double, std::milli>(total()).count());
+    return out;
+}
+
+
+} // namespace xci::term
@@ -0,0 +1,190 @@
+// PerfStats.h created on 2026-10-19
+// This file is part of Termic project <https://github.com/rbrich/termic>
+// Copyright 2026 Radek Brich
+// Licensed under the Apache License, Version 2.0 (see LICENSE file)
+
+#ifndef XCITERM_PERFSTATS_H
+#define XCITERM_PERFSTATS_H
+
+#include <atomic>
+#include <array>
+#include <chrono>
+#include <string>
+#include <cstdint>
+#include <cstddef>
+
+namespace xci::term {
+
+
+/// Counters maintained by the decoder (Terminal::decode_input).
+/// Cumulative, the rates are computed by PerfStats.
+struct DecodeCounters {
+    uint64_t text_bytes = 0;
+    uint64_t control = 0;   // C0 control characters
+    uint64_t escape = 0;    // ESC sequences (other than CSI, OSC)
+    uint64_t csi = 0;
+    uint64_t osc = 0;
+    uint64_t damaged_lines = 0;  // estimate: rows written by text output + erased rows
+};
+
+
+/// Fixed-size window of the most recent samples, with percentiles.
+template <size_t N>
+class RollingSamples {
+public:
+    void add(double v) {
+        m_samples[m_next] = v;
+        m_next = (m_next + 1) % N;
+        if (m_size < N)
+            ++m_size;
+    }
+
+    size_t size() const { return m_size; }
+    double last() const { return m_size ? m_samples[(m_next + N - 1) % N] : 0.0; }
+
+    /// \param q    quantile 0.0 .. 1.0 (e.g. 0.5 for median)
+    double percentile(double q) const;
+
+private:
+    std::array<double, N> m_samples {};
+    size_t m_next = 0;
+    size_t m_size = 0;
+};
+
+
+/// Per-terminal performance statistics.
+///
+/// PTY counters are updated from the I/O thread (atomic, relaxed),
+/// everything else is updated and read from the render thread.
+/// Rates are sampled once per second, per-frame values on each frame
+/// which decoded some input. Each value keeps a rolling window of samples.
+class PerfStats {
+public:
+    using Clock = std::chrono::steady_clock;
+    static constexpr size_t rate_window = 60;  // seconds
+    static constexpr size_t frame_window = 256;  // frames
+
+    // I/O thread
+
+    void add_pty_read(size_t bytes) {
+        m_pty_bytes.fetch_add(bytes, std::memory_order_relaxed);
+        m_pty_reads.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void add_wakeup() { m_wakeups.fetch_add(1, std::memory_order_relaxed); }
+
+    // render thread
+
+    /// Record a frame which decoded some input.
+    /// \param decode_time      time spent in decode_input
+    /// \param buffer_fill      ring buffer occupancy before decoding, 0.0 .. 1.0
+    /// \param counters         current (cumulative) decoder counters
+    void add_frame(std::chrono::nanoseconds decode_time, double buffer_fill,
+                   const DecodeCounters& counters);
+
+    /// Sample the rates if a second has elapsed. Call on each frame.
+    void update(Clock::time_point now);
+
+    /// Record keystroke-to-photon latency: the time from writing a keystroke
+    /// to the shell until the frame with its echo was drawn.
+    void add_input_latency(std::chrono::nanoseconds latency);
+
+    /// Query the stats
+    struct Value {
+        double last = 0;
+        double p50 = 0;
+        double p95 = 0;
+        double p99 = 0;
+    };
+    struct Snapshot {
+        Value pty_bytes_per_s;
+        Value pty_reads_per_s;
+        Value wakeups_per_s;
+        Value decode_us_per_frame;
+        Value buffer_fill_pct;
+        Value damaged_lines_per_frame;
+        Value text_bytes_per_s;
+        Value control_per_s;
+        Value escape_per_s;
+        Value csi_per_s;
+        Value osc_per_s;
+        Value input_latency_ms;
+    };
+    Snapshot snapshot() const;
+
+    /// Multi-line text for the overlay or a log
+    std::string format() const;
+
+    /// Histogram of all recorded input latencies (multi-line text)
+    std::string format_latency_histogram() const;
+
+private:
+    template <size_t N> static Value make_value(const RollingSamples<N>& s);
+
+    // I/O thread counters
+    std::atomic<uint64_t> m_pty_bytes {0};
+    std::atomic<uint64_t> m_pty_reads {0};
+    std::atomic<uint64_t> m_wakeups {0};
+
+    // last sampled values (to compute the rates)
+    Clock::time_point m_last_sample {};
+    uint64_t m_last_pty_bytes = 0;
+    uint64_t m_last_pty_reads = 0;
+    uint64_t m_last_wakeups = 0;
+    DecodeCounters m_last_rate_counters;
+    DecodeCounters m_last_frame_counters;
+    DecodeCounters m_counters;
+
+    RollingSamples<rate_window> m_pty_bytes_rate;
+    RollingSamples<rate_window> m_pty_reads_rate;
+    RollingSamples<rate_window> m_wakeups_rate;
+    RollingSamples<rate_window> m_text_rate;
+    RollingSamples<rate_window> m_control_rate;
+    RollingSamples<rate_window> m_escape_rate;
+    RollingSamples<rate_window> m_csi_rate;
+    RollingSamples<rate_window> m_osc_rate;
+    RollingSamples<frame_window> m_decode_us;
+    RollingSamples<frame_window> m_buffer_fill;
+    RollingSamples<frame_window> m_damaged_lines;
+    RollingSamples<frame_window> m_input_latency;
+
+    // input latency histogram, bucket N counts latencies in [2^(N-1), 2^N) ms
+    static constexpr size_t latency_buckets = 10;
+    std::array<uint64_t, latency_buckets> m_latency_hist {};
+};
+
+
+/// Durations of the startup phases, logged once the first shell output is shown.
+/// Used from the main thread only.
+class StartupTimer {
+public:
+    using Clock = std::chrono::steady_clock;
+    static constexpr size_t max_phases = 16;
+
+    StartupTimer() : m_start(Clock::now()), m_last(m_start) {}
+
+    /// Mark the end of a phase, which began at the end of the previous one.
+    /// \param name    static string
+    void phase(const char* name);
+
+    /// Total time since construction until the last phase
+    std::chrono::nanoseconds total() const { return m_last - m_start; }
+
+    /// Multi-line text for a log
+    std::string format() const;
+
+private:
+    struct Phase {
+        const char* name;
+        std::chrono::nanoseconds duration;
+    };
+    std::array<Phase, max_phases> m_phases {};
+    size_t m_num_phases = 0;
+    Clock::time_point m_start;
+    Clock::time_point m_last;
+};
+
+
+} // namespace xci::term
+
+#endif // XCITERM_PERFSTATS_H
@@ -14,6 +14,7 @@
 #include <sys/ioctl.h>
 #include <termios.h>
 #include <csignal>
+#include <cstring>
 
 using namespace xci::core;
 
@@ -29,7 +30,7 @@ void Pty::close()
 }
 
 
-bool Pty::open()
+bool Pty::open(core::Vec2u size_chars)
 {
     m_master = posix_openpt(O_RDWR);
     if (m_master == -1) {
@@ -47,11 +48,54 @@ bool Pty::open()
         return false;
     }
 
+    if (!init_slave(size_chars))
+        return false;
+
     log::info("Pty open: master {}", m_master);
     return true;
 }
 
 
+bool Pty::init_slave(core::Vec2u size_chars)
+{
+    // Set up the slave before the child opens it (see `fork`, `spawn`),
+    // so the shell sees the attributes and the size from its start
+    constexpr size_t sn_max = 50;
+    char slave_name[sn_max];
+    if (ptsname_r(m_master, slave_name, sn_max) != 0) {
+        log::error("ptsname_r: {m}");
+        return false;
+    }
+    int slave_fd = ::open(slave_name, O_RDWR | O_NOCTTY | O_CLOEXEC);
+    if (slave_fd == -1) {
+        log::error("open({}): {m}", slave_name);
+        return false;
+    }
+
+    termios tio;
+    if (tcgetattr(slave_fd, &tio) == 0) {
+        // UTF-8 aware line editing (erase removes whole character)
+#ifdef IUTF8
+        tio.c_iflag |= IUTF8;
+#endif
+        // Terminal sends BS for the Backspace key
+        tio.c_cc[VERASE] = '\b';
+        if (tcsetattr(slave_fd, TCSANOW, &tio) == -1)
+            log::error("tcsetattr: {m}");
+    } else
+        log::error("tcgetattr: {m}");
+
+    winsize ws = {};
+    ws.ws_row = (unsigned short)(size_chars.y);
+    ws.ws_col = (unsigned short)(size_chars.x);
+    if (ioctl(slave_fd, TIOCSWINSZ, &ws) == -1)
+        log::error("ioctl(TIOCSWINSZ): {m}");
+
+    ::close(slave_fd);
+    return true;
+}
+
+
 pid_t Pty::fork()
 {
     if (m_master == -1) {
@@ -102,12 +146,6 @@ pid_t Pty::fork()
     }
 #endif
 
-    // TODO
-    // set slave tty attributes
-    //if (tcsetattr(slave_fd, TCSANOW, termios) == -1)
-    // set slave tty window size
-    //if (ioctl(slave_fd, TIOCSWINSZ, window_size) == -1)
-
     // Duplicate pty slave to be child's stdin, stdout, and stderr
     if (dup2(slave_fd, STDIN_FILENO) != STDIN_FILENO) {
         log::error("dup2({}, STDIN_FILENO): {m}", slave_fd);
@@ -127,6 +165,69 @@ pid_t Pty::fork()
 }
 
 
+pid_t Pty::spawn(const char* file, char* const argv[], char* const envp[],
+                 const char* cwd)
+{
+#if defined(__linux__) && defined(POSIX_SPAWN_SETSID)
+    if (m_master == -1) {
+        log::error("Pty not initialized, cannot spawn.");
+        return (pid_t) -1;
+    }
+
+    constexpr size_t sn_max = 50;
+    char slave_name[sn_max];
+    if (ptsname_r(m_master, slave_name, sn_max) != 0) {
+        log::error("ptsname_r: {m}");
+        return (pid_t) -1;
+    }
+
+    // The child calls setsid() first, then opens the slave PTY as stdin
+    // (becoming its controlling terminal) and duplicates it to stdout, stderr.
+    // Signal mask and SIGPIPE disposition are reset, ignored signals would be inherited.
+    posix_spawnattr_t attr;
+    posix_spawnattr_init(&attr);
+    posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETSID | POSIX_SPAWN_SETSIGMASK
+                                    | POSIX_SPAWN_SETSIGDEF);
+    sigset_t sigmask;
+    sigemptyset(&sigmask);
+    posix_spawnattr_setsigmask(&attr, &sigmask);
+    sigset_t sigdefault;
+    sigemptyset(&sigdefault);
+    sigaddset(&sigdefault, SIGPIPE);
+    posix_spawnattr_setsigdefault(&attr, &sigdefault);
+
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_addclose(&actions, m_master);
+    posix_spawn_file_actions_addopen(&actions, STDIN_FILENO, slave_name, O_RDWR, 0);
+    posix_spawn_file_actions_adddup2(&actions, STDIN_FILENO, STDOUT_FILENO);
+    posix_spawn_file_actions_adddup2(&actions, STDIN_FILENO, STDERR_FILENO);
+    if (cwd != nullptr) {
+#if __GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 29)
+        posix_spawn_file_actions_addchdir_np(&actions, cwd);
+#else
+        log::warning("Pty spawn: can't change working directory to {}", cwd);
+#endif
+    }
+
+    pid_t child_pid = -1;
+    int rc = posix_spawnp(&child_pid, file, &actions, &attr, argv, envp);
+    posix_spawn_file_actions_destroy(&actions);
+    posix_spawnattr_destroy(&attr);
+    if (rc != 0) {
+        log::error("posix_spawnp({}): {}", file, std::strerror(rc));
+        return (pid_t) -1;
+    }
+    log::info("Pty spawn: child pid {}, slave {}", child_pid, slave_name);
+    return child_pid;
+#else
+    (void) file; (void) argv; (void) envp; (void) cwd;
+    log::error("Pty spawn: not supported on this platform");
+    return (pid_t) -1;
+#endif
+}
+
+
 ssize_t Pty::read(char* buffer, size_t size)
 {
     for (;;) {
@@ -142,7 +243,7 @@ ssize_t Pty::read(char* buffer, size_t size)
 }
 
 
-void Pty::write(const std::string &data)
+void Pty::write(std::string_view data)
 {
     ssize_t rc = ::write(m_master, data.data(), data.size());
     if (rc == -1) {
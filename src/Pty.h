@@ -6,8 +6,9 @@
 #ifndef XCITERM_PTY_H
 #define XCITERM_PTY_H
 
-#include <string>
+#include <string_view>
 #include <xci/core/geometry.h>
+#include <spawn.h>
 
 namespace xci::term {
 
@@ -18,7 +19,9 @@ public:
     ~Pty() { close(); }
 
     /// Open master PTY device, returns true on success.
-    bool open();
+    /// The slave gets initial window size (until `set_winsize`)
+    /// and terminal attributes matching Terminal (see `init_slave`).
+    bool open(core::Vec2u size_chars = {80, 24});
 
     /// Close master PTY. Safe to call when already closed.
     void close();
@@ -30,6 +33,16 @@ public:
     /// \return     -1 on error, PID >0 from parent, 0 from child
     pid_t fork();
 
+    /// Spawn a program with slave PTY as its controlling terminal and stdio.
+    /// Uses posix_spawn, which doesn't copy the parent's page tables
+    /// (glibc implements it with vfork-like clone). Not available everywhere,
+    /// check `can_spawn()` and use `fork()` otherwise.
+    /// \param cwd  working directory of the program, nullptr to inherit ours
+    /// \return     -1 on error, PID >0 on success
+    pid_t spawn(const char* file, char* const argv[], char* const envp[],
+                const char* cwd = nullptr);
+    static constexpr bool can_spawn();
+
     /// Master PTY file descriptor for event polling.
     int fileno() const { return m_master; }
 
@@ -38,16 +51,30 @@ public:
     ssize_t read(char* buffer, size_t size);
 
     /// Blocking write
-    void write(const std::string &data);
+    void write(std::string_view data);
 
     /// Set window size in characters
     void set_winsize(core::Vec2u size_chars);
 
 private:
+    bool init_slave(core::Vec2u size_chars);
+
     int m_master = -1;
 };
 
 
+constexpr bool Pty::can_spawn()
+{
+    // Opening the slave PTY after setsid() acquires the controlling terminal
+    // only on Linux. Elsewhere, TIOCSCTTY has to be called in the child.
+#if defined(__linux__) && defined(POSIX_SPAWN_SETSID)
+    return true;
+#else
+    return false;
+#endif
+}
+
+
 } // namespace xci::term
 
 #endif // XCITERM_PTY_H
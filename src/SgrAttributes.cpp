@@ -0,0 +1,148 @@
+// SgrAttributes.cpp created on 2026-10-19
+// This file is part of Termic project <https://github.com/rbrich/termic>
+// Copyright 2026 Radek Brich
+// Licensed under the Apache License, Version 2.0 (see LICENSE file)
+
+#include "SgrAttributes.h"
+#include "UnknownSeqStats.h"
+#include "utility.h"
+#include "debug_log.h"
+#include <fmt/format.h>
+#include <iterator>
+
+namespace xci::term {
+
+using UnknownSeq = UnknownSeqStats::Kind;
+
+
+static bool decode_sgr_color(const CseqParams& params, unsigned& i, SgrColor& color)
+{
+    // ITU T.416 format - colon separated sub-parameters,
+    // with color space identifier for RGB (usually left empty):
+    //   "\e[38:2:<color-space-id>:<r>:<g>:<b>m"
+    //   "\e[38:5:<index>m"
+    // Hybrid format, colon-separated but without the color space id:
+    //   "\e[38:2:<r>:<g>:<b>m"
+    // Semicolon-separated xterm-compatible format:
+    //   "\e[38;2;<r>;<g>;<b>m"
+    //   "\e[38;5;<index>m"
+    const unsigned nsub = params.num_sub(i);
+    if (nsub != 0) {
+        const unsigned type = params.sub(i, 0, 0);
+        if (type == 5 && nsub >= 2) {
+            color = SgrColor::color8bit(uint8_t(params.sub(i, 1, 0)));
+            return true;
+        }
+        if (type == 2 && nsub >= 4) {
+            const unsigned o = nsub >= 5 ? 2 : 1;  // skip color space id
+            color = SgrColor::color24bit(uint8_t(params.sub(i, o, 0)),
+                                         uint8_t(params.sub(i, o + 1, 0)),
+                                         uint8_t(params.sub(i, o + 2, 0)));
+            return true;
+        }
+        return false;
+    }
+    const unsigned type = params.get(i + 1, 0);
+    if (type == 5 && i + 2 < params.size()) {
+        color = SgrColor::color8bit(uint8_t(params.get(i + 2, 0)));
+        i += 2;
+        return true;
+    }
+    if (type == 2 && i + 4 < params.size()) {
+        color = SgrColor::color24bit(uint8_t(params.get(i + 2, 0)),
+                                     uint8_t(params.get(i + 3, 0)),
+                                     uint8_t(params.get(i + 4, 0)));
+        i += 4;
+        return true;
+    }
+    // skip the rest, we don't know how many params belong to this color
+    i = params.size();
+    return false;
+}
+
+
+void apply_sgr(SgrAttributes& attrs, const CseqParams& params, UnknownSeqStats* unknown)
+{
+    auto add_unknown = [unknown](unsigned p) {
+        if (unknown)
+            unknown->add(UnknownSeq::SGR, 'm', p);
+    };
+    if (params.empty())
+        attrs = sgr_default;  // CSI m == CSI 0 m
+    for (unsigned i = 0; i < params.size(); ++i) {
+        const unsigned p = params.get(i, 0);
+        if (p == 0) {
+            // reset all attributes
+            attrs = sgr_default;
+        } else if (p == 1) {
+            attrs.bold = true;
+        } else if (p == 4) {
+            // "4" or "4:<style>" (0 = none, 1 = single, 2 = double, 3 = curly, ...)
+            attrs.underline = uint8_t(std::min(params.sub(i, 0, 1), 255u));
+        } else if (p == 22) {
+            attrs.bold = false;
+        } else if (p == 24) {
+            attrs.underline = 0;
+        } else if (p >= 30 && p <= 37) {
+            attrs.fg = SgrColor::color4bit(uint8_t(p - 30));
+        } else if (p == 38) {
+            if (!decode_sgr_color(params, i, attrs.fg)) {
+                add_unknown(p);
+                TERMIC_DEBUG("Unknown SGR {}", params);
+            }
+        } else if (p == 39) {
+            attrs.fg = sgr_default.fg;
+        } else if (p >= 40 && p <= 47) {
+            attrs.bg = SgrColor::color4bit(uint8_t(p - 40));
+        } else if (p == 48) {
+            if (!decode_sgr_color(params, i, attrs.bg)) {
+                add_unknown(p);
+                TERMIC_DEBUG("Unknown SGR {}", params);
+            }
+        } else if (p == 49) {
+            attrs.bg = sgr_default.bg;
+        } else if (p >= 90 && p <= 97) {
+            attrs.fg = SgrColor::color4bit(uint8_t(p - 90 + 8));
+        } else if (p >= 100 && p <= 107) {
+            attrs.bg = SgrColor::color4bit(uint8_t(p - 100 + 8));
+        } else {
+            add_unknown(p);
+            TERMIC_DEBUG("Unknown SGR {}", p);
+        }
+    }
+}
+
+
+void encode_sgr(std::string& out, const SgrAttributes& attrs)
+{
+    auto it = std::back_inserter(out);
+    // `base` is 30 for foreground, 40 for background
+    auto encode_color = [&it](const SgrColor& color, unsigned base) {
+        switch (color.kind) {
+            case SgrColor::Kind::Color4bit:
+                fmt::format_to(it, ";{}", color.r < 8 ? base + color.r : base + 60 + color.r - 8);
+                break;
+            case SgrColor::Kind::Color8bit:
+                fmt::format_to(it, ";{};5;{}", base + 8, color.r);
+                break;
+            case SgrColor::Kind::Color24bit:
+                fmt::format_to(it, ";{};2;{};{};{}", base + 8, color.r, color.g, color.b);
+                break;
+        }
+    };
+    out += "\033[0";
+    if (attrs.bold)
+        out += ";1";
+    if (attrs.underline == 1)
+        out += ";4";
+    else if (attrs.underline != 0)
+        fmt::format_to(it, ";4:{}", attrs.underline);
+    if (attrs.fg != sgr_default.fg)
+        encode_color(attrs.fg, 30);
+    if (attrs.bg != sgr_default.bg)
+        encode_color(attrs.bg, 40);
+    out += 'm';
+}
+
+
+} // namespace xci::term
@@ -0,0 +1,63 @@
+// SgrAttributes.h created on 2026-10-19
+// This file is part of Termic project <https://github.com/rbrich/termic>
+// Copyright 2026 Radek Brich
+// Licensed under the Apache License, Version 2.0 (see LICENSE file)
+
+#ifndef XCITERM_SGRATTRIBUTES_H
+#define XCITERM_SGRATTRIBUTES_H
+
+#include <string>
+#include <cstdint>
+
+namespace xci::term {
+
+class CseqParams;
+class UnknownSeqStats;
+
+
+/// Color as selected by SGR: 4-bit, 8-bit (indexed) or 24-bit (RGB).
+/// For 4-bit and 8-bit colors, the index is stored in `r`.
+struct SgrColor {
+    enum class Kind: uint8_t { Color4bit, Color8bit, Color24bit };
+
+    static constexpr SgrColor color4bit(uint8_t idx) { return {Kind::Color4bit, idx}; }
+    static constexpr SgrColor color8bit(uint8_t idx) { return {Kind::Color8bit, idx}; }
+    static constexpr SgrColor color24bit(uint8_t r, uint8_t g, uint8_t b) { return {Kind::Color24bit, r, g, b}; }
+
+    bool operator==(const SgrColor&) const = default;
+
+    Kind kind = Kind::Color4bit;
+    uint8_t r = 0;
+    uint8_t g = 0;
+    uint8_t b = 0;
+};
+
+
+/// Complete set of graphic rendition attributes (the result of SGR sequence).
+struct SgrAttributes {
+    bool operator==(const SgrAttributes&) const = default;
+
+    SgrColor fg;
+    SgrColor bg;
+    bool bold = false;
+    uint8_t underline = 0;  // 0 = none, 1 = single, other values = style (see SGR 4:x)
+};
+
+
+/// Attributes after reset (SGR 0): white on black
+inline constexpr SgrAttributes sgr_default = {
+        .fg = SgrColor::color4bit(7),
+        .bg = SgrColor::color4bit(0) };
+
+
+/// Apply parameters of SGR sequence (`CSI <params> m`) to `attrs`.
+/// Unsupported parameters are counted in `unknown`, if it's not null.
+void apply_sgr(SgrAttributes& attrs, const CseqParams& params, UnknownSeqStats* unknown);
+
+/// Append SGR sequence which resets the attributes and then sets `attrs`
+void encode_sgr(std::string& out, const SgrAttributes& attrs);
+
+
+} // namespace xci::term
+
+#endif // XCITERM_SGRATTRIBUTES_H
@@ -5,15 +5,32 @@
 
 #include "Shell.h"
 #include "Terminal.h"
+#include "MuxServer.h"
 #include <xci/core/log.h>
+#include <fmt/core.h>
 #include <unistd.h>
 #include <poll.h>
 #include <chrono>
 #include <csignal>
 #include <cstdlib>
-#include <cassert>
+#include <cstring>
+#include <string>
+#include <vector>
 #include <pwd.h>
 #include <sys/wait.h>
+#include <sys/syscall.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <climits>
+
+#ifdef __APPLE__
+#include <libproc.h>
+#endif
+
+// Not declared by <unistd.h> on macOS
+extern char** environ;
 
 using namespace std::chrono_literals;
 using namespace xci::core;
@@ -23,34 +40,117 @@ namespace xci::term {
 
 Shell::~Shell()
 {
+    // Don't wait for the shell, it got SIGHUP and it will exit on its own
     stop();
-    join();
+    reap();
+    close();
 }
 
 
-bool Shell::start()
+bool Shell::start(const std::string& cwd, std::vector<std::string> environment)
 {
     if (!m_pty.open())
         return false;
 
-    m_pid = m_pty.fork();
-    if (m_pid == -1)
-        return false;
+    // Environment for the child: ours (or the given one), with TERM replaced
+    if (environment.empty()) {
+        for (char** env = environ; *env != nullptr; ++env)
+            environment.emplace_back(*env);
+    }
+    std::erase_if(environment, [](const std::string& var) { return var.starts_with("TERM="); });
+    m_environment = std::move(environment);
+    std::string term = "TERM=xterm";
+    std::vector<char*> envp;
+    envp.reserve(m_environment.size() + 2);
+    for (auto& var : m_environment)
+        envp.push_back(var.data());
+    envp.push_back(term.data());
+    envp.push_back(nullptr);
 
-    if (m_pid == 0) {
-        // child
-        ::setenv("TERM", "xterm", 1);
+    // The directory may be gone since it was saved, the spawn would then fail
+    const char* work_dir = nullptr;
+    if (!cwd.empty()) {
+        struct stat st;
+        if (::stat(cwd.c_str(), &st) == 0 && S_ISDIR(st.st_mode))
+            work_dir = cwd.c_str();
+        else
+            log::warning("Shell: {} is not a directory, not changing to it", cwd);
+    }
+
+    if constexpr (Pty::can_spawn()) {
         auto* shell = getpwuid(getuid())->pw_shell;
-        if (execlp(shell, shell, nullptr) == -1) {
-            log::error("execlp: {m}");
-            _exit(-1);
-        }
-        __builtin_unreachable();
+        char* argv[] = {shell, nullptr};
+        m_pid = m_pty.spawn(shell, argv, envp.data(), work_dir);
     } else {
-        // parent
-        assert(m_pid > 0);
-        return true;
+        m_pid = m_pty.fork();
+        if (m_pid == 0) {
+            // child
+            if (work_dir != nullptr && ::chdir(work_dir) == -1)
+                log::error("chdir({}): {m}", work_dir);
+            environ = envp.data();
+            std::signal(SIGPIPE, SIG_DFL);
+            auto* shell = getpwuid(getuid())->pw_shell;
+            if (execlp(shell, shell, nullptr) == -1) {
+                log::error("execlp: {m}");
+                _exit(-1);
+            }
+            __builtin_unreachable();
+        }
+    }
+    if (m_pid == -1)
+        return false;
+
+#ifdef SYS_pidfd_open
+    // Linux 5.3+, older kernels return ENOSYS - the shell is then reaped on PTY EOF
+    m_pidfd = int(::syscall(SYS_pidfd_open, m_pid, 0));
+    if (m_pidfd == -1)
+        log::warning("pidfd_open: {m}");
+#endif
+    return true;
+}
+
+
+bool Shell::attach(const std::string& socket_path)
+{
+    sockaddr_un addr = {};
+    addr.sun_family = AF_UNIX;
+    if (socket_path.size() >= sizeof(addr.sun_path)) {
+        log::error("Shell: socket path too long: {}", socket_path);
+        return false;
+    }
+    std::memcpy(addr.sun_path, socket_path.c_str(), socket_path.size() + 1);
+    if (!mux::check_socket_dir(socket_path, /*create=*/false))
+        return false;
+
+    m_mux_fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (m_mux_fd == -1) {
+        log::error("Shell: socket: {m}");
+        return false;
+    }
+    ::fcntl(m_mux_fd, F_SETFD, FD_CLOEXEC);
+    if (::connect(m_mux_fd, (sockaddr*) &addr, sizeof(addr)) == -1) {
+        log::error("Shell: attach {}: {m}", socket_path);
+        ::close(m_mux_fd);
+        m_mux_fd = -1;
+        return false;
     }
+    if (!mux::check_peer(m_mux_fd)) {
+        ::close(m_mux_fd);
+        m_mux_fd = -1;
+        return false;
+    }
+    // The server starts with the size of the replayed output (uint32, little-endian)
+    uint8_t header[4];
+    if (::recv(m_mux_fd, header, sizeof(header), MSG_WAITALL) != sizeof(header)) {
+        log::error("Shell: attach {}: no response from server", socket_path);
+        ::close(m_mux_fd);
+        m_mux_fd = -1;
+        return false;
+    }
+    m_replay_size = size_t(header[0]) | size_t(header[1]) << 8
+                  | size_t(header[2]) << 16 | size_t(header[3]) << 24;
+    log::info("Shell: attached to {}", socket_path);
+    return true;
 }
 
 
@@ -63,31 +163,183 @@ void Shell::stop()
 
 ssize_t Shell::read(char* buffer, size_t size)
 {
-    return m_pty.read(buffer, size);
+    if (m_mux_fd == -1)
+        return m_pty.read(buffer, size);
+    for (;;) {
+        ssize_t nread = ::read(m_mux_fd, buffer, size);
+        if (nread == -1) {
+            if (errno == EINTR || errno == EAGAIN)
+                continue;
+            log::error("read: {m}");
+        }
+        return nread;
+    }
+}
+
+
+void Shell::write(std::string_view data)
+{
+    if (is_closed())
+        return;
+    if (m_mux_fd == -1) {
+        m_pty.write(data);
+        return;
+    }
+    write_mux(mux::Message::Input, data);
 }
 
 
-void Shell::write(const std::string &data)
+void Shell::reply(std::string_view data)
 {
-    m_pty.write(data);
+    if (is_closed())
+        return;
+    if (m_mux_fd == -1) {
+        m_pty.write(data);
+        return;
+    }
+    write_mux(mux::Message::Reply, data);
 }
 
 
-int Shell::join()
+bool Shell::writable() const
 {
-    m_pty.close();
+    pollfd pfd = {fileno(), POLLOUT, 0};
+    return ::poll(&pfd, 1, 0) == 1 && (pfd.revents & POLLOUT);
+}
+
+
+void Shell::notify_writable(std::function<void()> cb)
+{
+    if (m_waiting_writable.exchange(true))
+        return;
+    if (m_writable_waiter.joinable())
+        m_writable_waiter.join();  // the previous wait, already finished
+    if (m_cancel_pipe[0] == -1 && ::pipe(m_cancel_pipe) == -1) {
+        log::error("pipe: {m}");
+        m_cancel_pipe[0] = m_cancel_pipe[1] = -1;
+        m_waiting_writable = false;
+        return;
+    }
+    m_writable_waiter = std::thread([this, cb = std::move(cb)] {
+        pollfd fds[2] = {{fileno(), POLLOUT, 0}, {m_cancel_pipe[0], POLLIN, 0}};
+        while (::poll(fds, 2, -1) == -1 && errno == EINTR) {}
+        if (fds[1].revents != 0)
+            return;  // cancelled
+        m_waiting_writable = false;
+        cb();
+    });
+}
+
+
+void Shell::cancel_notify_writable()
+{
+    if (!m_writable_waiter.joinable())
+        return;
+    const char c = 0;
+    if (m_waiting_writable && ::write(m_cancel_pipe[1], &c, 1) == -1)
+        log::error("write: {m}");
+    m_writable_waiter.join();
+    m_waiting_writable = false;
+    // A cancel byte may be left unread if the waiter was finishing, start over
+    ::close(m_cancel_pipe[0]);
+    ::close(m_cancel_pipe[1]);
+    m_cancel_pipe[0] = m_cancel_pipe[1] = -1;
+}
+
+
+void Shell::set_winsize(core::Vec2u size_chars)
+{
+    if (m_mux_fd == -1) {
+        m_pty.set_winsize(size_chars);
+        return;
+    }
+    const char payload[4] = {
+            char(size_chars.x & 0xff), char((size_chars.x >> 8) & 0xff),
+            char(size_chars.y & 0xff), char((size_chars.y >> 8) & 0xff)};
+    write_mux(mux::Message::Resize, {payload, sizeof(payload)});
+}
+
+
+void Shell::write_mux(mux::Message type, std::string_view payload)
+{
+    m_mux_out.clear();
+    mux::encode(m_mux_out, type, payload);
+    for (std::string_view data = m_mux_out; !data.empty(); ) {
+        // The server may go away while we're writing to it, don't get SIGPIPE
+        auto n = ::send(m_mux_fd, data.data(), data.size(), MSG_NOSIGNAL);
+        if (n == -1) {
+            if (errno == EINTR)
+                continue;
+            log::error("write: {m}");
+            return;
+        }
+        data.remove_prefix(size_t(n));
+    }
+}
+
+
+bool Shell::reap()
+{
+    m_closed.store(true, std::memory_order_release);
     if (m_pid == -1)
-        return 0;
+        return true;
 
     int wstatus;
-    waitpid(m_pid, &wstatus, 0);
+    auto rc = waitpid(m_pid, &wstatus, WNOHANG);
+    if (rc == 0)
+        return false;  // still running
     m_pid = -1;
 
+    if (rc == -1) {
+        log::error("waitpid: {m}");
+        return true;
+    }
     if (WIFEXITED(wstatus))
         log::info("Shell exited: {}", WEXITSTATUS(wstatus));
     if (WIFSIGNALED(wstatus))
         log::warning("Shell killed: {}", WTERMSIG(wstatus));
-    return wstatus;
+    return true;
+}
+
+
+std::string Shell::cwd() const
+{
+    if (m_pid == -1)
+        return {};
+#if defined(__linux__)
+    char buf[PATH_MAX];
+    const auto link = fmt::format("/proc/{}/cwd", m_pid);
+    const auto n = ::readlink(link.c_str(), buf, sizeof(buf));
+    if (n == -1 || size_t(n) == sizeof(buf)) {
+        log::warning("readlink {}: {m}", link);
+        return {};
+    }
+    return {buf, size_t(n)};
+#elif defined(__APPLE__)
+    proc_vnodepathinfo info;
+    if (proc_pidinfo(m_pid, PROC_PIDVNODEPATHINFO, 0, &info, sizeof(info)) != sizeof(info)) {
+        log::warning("proc_pidinfo({}): {m}", m_pid);
+        return {};
+    }
+    return info.pvi_cdir.vip_path;
+#else
+    return {};
+#endif
+}
+
+
+void Shell::close()
+{
+    cancel_notify_writable();
+    m_pty.close();
+    if (m_mux_fd != -1) {
+        ::close(m_mux_fd);
+        m_mux_fd = -1;
+    }
+    if (m_pidfd != -1) {
+        ::close(m_pidfd);
+        m_pidfd = -1;
+    }
 }
 
 
@@ -11,33 +11,98 @@
 #include <atomic>
 #include <array>
 #include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+#include <cstdint>
 
 namespace xci::term {
 
 class Terminal;
+namespace mux { enum class Message: uint8_t; }
 
 
 // Run actual shell (e.g. Bash) in child process,
 // with established PTY.
+// Alternatively, attach to a shell session owned by `termic --server`.
 class Shell {
 public:
     ~Shell();
 
-    bool start();
+    /// Start the shell in `cwd` (if not empty), with `environment`
+    /// ("NAME=value") instead of ours (if not empty), e.g. restored
+    /// from a Snapshot. TERM is set for the terminal in either case.
+    bool start(const std::string& cwd = {}, std::vector<std::string> environment = {});
     void stop();
 
-    // following usable after start()
-    int fileno() const { return m_pty.fileno(); }
+    /// Attach to a session of MuxServer instead of starting the shell.
+    /// The session is not affected by `stop` - it continues in the server.
+    bool attach(const std::string& socket_path);
+
+    // following usable after start() or attach()
+    int fileno() const { return m_mux_fd != -1 ? m_mux_fd : m_pty.fileno(); }
     ssize_t read(char* buffer, size_t size);
-    void write(const std::string& data);
-    int join();
-    bool is_closed() const { return m_pty.is_closed(); }
+    void write(std::string_view data);
+
+    /// Answer to a query of the application (e.g. DA). Unlike `write`,
+    /// the server accepts it only from one of the attached clients.
+    void reply(std::string_view data);
+
+    /// Size of the recent output replayed by the server after `attach`.
+    /// The queries in it were already answered, don't reply to them again.
+    size_t replay_size() const { return m_replay_size; }
+    void set_winsize(core::Vec2u size_chars);
+    bool writable() const;  // write won't block
+
+    /// Call `cb` once the shell can take more input (see `writable`).
+    /// The wait runs in a helper thread, `cb` is called from it.
+    /// Repeated calls while waiting are ignored.
+    void notify_writable(std::function<void()> cb);
+
+    /// Stop waiting (see `notify_writable`), `cb` won't be called after this returns.
+    void cancel_notify_writable();
+    bool is_closed() const { return m_closed.load(std::memory_order_acquire); }
+
+    /// Descriptor which becomes readable when the shell exits (Linux pidfd),
+    /// or -1 when not available. Watch it in event loop and call `reap`.
+    int pidfd() const { return m_pidfd; }
+
+    /// Mark the shell closed (see `is_closed`) and collect the shell process,
+    /// if it has exited. Never blocks - a running shell is collected on a later call.
+    /// The descriptors stay open, they may still be registered in an event loop.
+    /// \returns true if the shell process is gone
+    bool reap();
+
+    /// Close the PTY, the server connection and the pidfd.
+    /// Call after they were removed from the event loop (or let the destructor do it).
+    void close();
 
     Pty& pty() { return m_pty; }
 
+    /// The environment the shell was started with (without TERM)
+    const std::vector<std::string>& environment() const { return m_environment; }
+
+    /// Current working directory of the shell process,
+    /// empty when not known (not started, exited or not supported)
+    std::string cwd() const;
+
 private:
+    void write_mux(mux::Message type, std::string_view payload);
+
     Pty m_pty;
     pid_t m_pid = -1;
+    int m_pidfd = -1;
+    std::vector<std::string> m_environment;
+
+    int m_mux_fd = -1;  // attached to MuxServer
+    std::string m_mux_out;
+    size_t m_replay_size = 0;
+
+    std::atomic<bool> m_closed {false};  // EOF or the shell exited
+
+    std::thread m_writable_waiter;
+    std::atomic<bool> m_waiting_writable {false};
+    int m_cancel_pipe[2] = {-1, -1};  // wakes the waiter when cancelled
 };
 
 
@@ -0,0 +1,133 @@
+// Snapshot.cpp created on 2026-10-19
+// This file is part of Termic project <https://github.com/rbrich/termic>
+// Copyright 2026 Radek Brich
+// Licensed under the Apache License, Version 2.0 (see LICENSE file)
+
+#include "Snapshot.h"
+#include <xci/core/log.h>
+#include <cerrno>
+#include <cstdio>
+
+using namespace xci::core;
+
+namespace xci::term {
+
+static constexpr std::string_view c_magic = "TMSN";
+
+
+static void put_u32(std::string& out, uint32_t v)
+{
+    for (unsigned b = 0; b != 4; ++b)
+        out += char((v >> (8 * b)) & 0xff);
+}
+
+
+static void put_string(std::string& out, std::string_view s)
+{
+    put_u32(out, uint32_t(s.size()));
+    out.append(s);
+}
+
+
+static bool get_u32(std::string_view& in, uint32_t& v)
+{
+    if (in.size() < 4)
+        return false;
+    v = 0;
+    for (unsigned b = 0; b != 4; ++b)
+        v |= uint32_t(uint8_t(in[b])) << (8 * b);
+    in.remove_prefix(4);
+    return true;
+}
+
+
+static bool get_string(std::string_view& in, std::string& s)
+{
+    uint32_t size;
+    if (!get_u32(in, size) || in.size() < size)
+        return false;
+    s.assign(in.substr(0, size));
+    in.remove_prefix(size);
+    return true;
+}
+
+
+void Snapshot::encode(std::string& out) const
+{
+    out.append(c_magic);
+    put_u32(out, version);
+    put_string(out, cwd);
+    put_u32(out, uint32_t(environment.size()));
+    for (const auto& var : environment)
+        put_string(out, var);
+}
+
+
+bool Snapshot::decode(std::string_view data)
+{
+    if (data.substr(0, c_magic.size()) != c_magic)
+        return false;
+    data.remove_prefix(c_magic.size());
+    uint32_t ver;
+    if (!get_u32(data, ver) || ver != version)
+        return false;
+    if (!get_string(data, cwd))
+        return false;
+    uint32_t count;
+    // each variable takes at least 4 bytes, don't trust the count for reserve
+    if (!get_u32(data, count) || count > data.size() / 4)
+        return false;
+    environment.resize(count);
+    for (auto& var : environment) {
+        if (!get_string(data, var))
+            return false;
+    }
+    return data.empty();
+}
+
+
+bool Snapshot::save(const std::string& path) const
+{
+    std::string data;
+    encode(data);
+    const std::string tmp_path = path + ".tmp";
+    std::FILE* f = std::fopen(tmp_path.c_str(), "wb");
+    if (!f) {
+        log::error("Snapshot: fopen({}): {m}", tmp_path);
+        return false;
+    }
+    const bool ok = std::fwrite(data.data(), 1, data.size(), f) == data.size();
+    if (std::fclose(f) != 0 || !ok) {
+        log::error("Snapshot: write {}: {m}", tmp_path);
+        std::remove(tmp_path.c_str());
+        return false;
+    }
+    if (std::rename(tmp_path.c_str(), path.c_str()) != 0) {
+        log::error("Snapshot: rename {}: {m}", path);
+        std::remove(tmp_path.c_str());
+        return false;
+    }
+    return true;
+}
+
+
+bool Snapshot::load(const std::string& path)
+{
+    std::FILE* f = std::fopen(path.c_str(), "rb");
+    if (!f) {
+        if (errno != ENOENT)
+            log::error("Snapshot: fopen({}): {m}", path);
+        return false;
+    }
+    std::string data(max_size + 1, '\0');
+    data.resize(std::fread(data.data(), 1, data.size(), f));
+    std::fclose(f);
+    if (data.size() > max_size || !decode(data)) {
+        log::warning("Snapshot: {} is not a valid snapshot, ignored", path);
+        return false;
+    }
+    return true;
+}
+
+
+} // namespace xci::term
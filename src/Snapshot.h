@@ -0,0 +1,56 @@
+// Snapshot.h created on 2026-10-19
+// This file is part of Termic project <https://github.com/rbrich/termic>
+// Copyright 2026 Radek Brich
+// Licensed under the Apache License, Version 2.0 (see LICENSE file)
+
+#ifndef XCITERM_SNAPSHOT_H
+#define XCITERM_SNAPSHOT_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstdint>
+
+namespace xci::term {
+
+
+/// Session snapshot (`termic --session FILE`)
+///
+/// The part of a session owned by termic: the working directory
+/// of the shell and the environment it was started with. It's saved when
+/// the window is closed and the next start with the same file
+/// starts the shell there again. Screen and scrollback live in xcikit's
+/// TextTerminal and aren't saved (see DEVEL.md).
+///
+/// File format (integers are uint32, little-endian):
+/// - magic "TMSN", format version
+/// - cwd: size, bytes
+/// - environment: number of variables, then each as size, bytes ("NAME=value")
+struct Snapshot {
+    static constexpr uint32_t version = 1;
+    static constexpr size_t max_size = 1024 * 1024;  // the file is not read if larger
+
+    std::string cwd;
+    std::vector<std::string> environment;
+
+    /// Append the serialized snapshot to `out`
+    void encode(std::string& out) const;
+
+    /// Parse serialized snapshot, replacing the content of this one
+    /// \returns false if the data is malformed or of different version
+    ///          (the content is then unspecified)
+    bool decode(std::string_view data);
+
+    /// Write the snapshot to a file (via a temporary file, so a crash
+    /// doesn't leave a partially written one)
+    bool save(const std::string& path) const;
+
+    /// Read the snapshot from a file
+    /// \returns false if the file doesn't exist or is not a valid snapshot
+    bool load(const std::string& path);
+};
+
+
+} // namespace xci::term
+
+#endif // XCITERM_SNAPSHOT_H
@@ -5,11 +5,16 @@
 
 #include "Terminal.h"
 #include "utility.h"
+#include "unicode.h"
+#include "debug_log.h"
+#include "Tracer.h"
 #include <xci/core/log.h>
 #include <xci/core/string.h>  // NOLINT(modernize-deprecated-headers) - FP
 #include <fmt/ostream.h>
 #include <iostream>
 #include <cstdlib>
+#include <algorithm>
+#include <cstring>
 
 namespace xci::term {
 
@@ -21,13 +26,70 @@ using namespace std::chrono_literals;
 
 void Terminal::resize(graphics::View &view)
 {
-    auto orig_size = size_in_cells();
     TextTerminal::resize(view);
     auto new_size = size_in_cells();
-    if (orig_size != new_size) {
-        log::debug("Terminal: resize {} cells", size_in_cells());
-        m_shell.pty().set_winsize(size_in_cells());
+    if (m_winsize == core::Vec2u{}) {
+        // Initial size - the shell is waiting for it
+        log::debug("Terminal: resize {} cells", new_size);
+        m_winsize = new_size;
+        m_shell.set_winsize(new_size);
+        return;
     }
+    m_winsize_pending = new_size != m_winsize;
+    m_resized = Clock::now();
+}
+
+
+void Terminal::update_winsize(graphics::View& view)
+{
+    if (!m_winsize_pending)
+        return;
+    const auto now = Clock::now();
+    if (now - m_resized < c_resize_settle) {
+        // Still resizing, or no more events will come - check again once it settles
+        const auto left = m_resized + c_resize_settle - now;
+        view.window()->set_refresh_timeout(
+                std::chrono::ceil<std::chrono::microseconds>(left), /*periodic=*/false);
+        return;
+    }
+    m_winsize_pending = false;
+    m_winsize = size_in_cells();
+    log::debug("Terminal: resize {} cells", m_winsize);
+    m_shell.set_winsize(m_winsize);
+}
+
+
+void Terminal::draw(View& view)
+{
+    TERMIC_TRACE_SCOPE("draw");
+    TextTerminal::draw(view);
+    if (m_clipboard_pending) {
+        m_clipboard_pending = false;
+        view.window()->set_clipboard_string(m_clipboard);
+        std::string().swap(m_clipboard);  // may be big, don't keep it
+    }
+    if (m_echo_decoded) {
+        // This frame shows the echo of the pending keystrokes
+        m_echo_decoded = false;
+        auto now = Clock::now();
+        for (unsigned i = 0; i != m_num_keystrokes; ++i)
+            m_perf_stats.add_input_latency(now - m_keystrokes[i]);
+        m_num_keystrokes = 0;
+    }
+}
+
+
+void Terminal::input_written(View& view)
+{
+    auto now = Clock::now();
+    if (m_num_keystrokes < m_keystrokes.size())
+        m_keystrokes[m_num_keystrokes++] = now;
+    // In low latency mode, don't draw a frame now, unless the scrollback
+    // was cancelled. The echo will come shortly and its frame
+    // would otherwise have to wait for this one.
+    if (!m_low_latency || m_scrolled_back)
+        view.refresh();
+    m_scrolled_back = false;
 }
 
 
@@ -36,7 +98,7 @@ bool Terminal::key_event(View &view, const KeyEvent &ev)
     if (ev.action == Action::Release)
         return false;
 
-    std::string seq;
+    std::string_view seq;
 
     if (ev.mod == ModKey::None()) {
         switch (ev.key) {
@@ -73,22 +135,24 @@ bool Terminal::key_event(View &view, const KeyEvent &ev)
         }
         m_shell.write(seq);
         cancel_scrollback();
-        view.refresh();
+        input_written(view);
         return true;
     }
 
     if (ev.mod == ModKey::Ctrl()) {
         // ^A .. ^Z, ^[, ^\, ^]
+        char ctl;
         if (ev.key >= Key::A && ev.key <= Key::RightBracket) {
             // '\1' .. '\x1d'
-            seq = char(int(ev.key) - int(Key::A) + 1);
+            ctl = char(int(ev.key) - int(Key::A) + 1);
+            seq = {&ctl, 1};
         } else {
             log::debug("Terminal::key_event: Unhandled key: Ctrl + {}", int(ev.key));
             return false;
         }
         m_shell.write(seq);
         cancel_scrollback();
-        view.refresh();
+        input_written(view);
         return true;
     }
 
@@ -132,26 +196,128 @@ bool Terminal::key_event(View &view, const KeyEvent &ev)
 
 void Terminal::char_event(View &view, const CharEvent &ev)
 {
-    log::debug("Input char: {}", ev.code_point);
-    m_shell.write(to_utf8(ev.code_point));
-    view.refresh();
+    TERMIC_DEBUG("Input char: {}", ev.code_point);
+    char utf8[4];
+    m_shell.write({utf8, encode_utf8(ev.code_point, utf8)});
+    input_written(view);
 }
 
 
 void Terminal::scroll_event(View& view, const ScrollEvent& ev)
 {
-    log::debug("Scroll: {}", ev.offset);
+    TERMIC_DEBUG("Scroll: {}", ev.offset);
+    if (m_mouse.enabled()) {
+        // Touchpads scroll by fractions, report whole steps
+        m_wheel += ev.offset.y;
+        for (; m_wheel >= 1.0f; m_wheel -= 1.0f)
+            m_mouse.button(MouseReporter::Button::WheelUp, true, m_mouse_cell);
+        for (; m_wheel <= -1.0f; m_wheel += 1.0f)
+            m_mouse.button(MouseReporter::Button::WheelDown, true, m_mouse_cell);
+        view.window()->wakeup();
+        return;
+    }
     scrollback(ev.offset.y * 3.0);
+    m_scrolled_back = true;
     view.refresh();
 }
 
 
+MouseReporter::Pos Terminal::cell_at(core::Vec2f pos) const
+{
+    const auto cells = size_in_cells();
+    const auto rel = pos - position();
+    const auto sz = size();
+    const int x = sz.x > 0 ? int(rel.x * float(cells.x) / sz.x) : 0;
+    const int y = sz.y > 0 ? int(rel.y * float(cells.y) / sz.y) : 0;
+    return {std::clamp(x, 0, int(cells.x) - 1), std::clamp(y, 0, int(cells.y) - 1)};
+}
+
+
+void Terminal::mouse_pos_event(View& view, const MousePosEvent& ev)
+{
+    const auto cell = cell_at(ev.pos);
+    if (cell == m_mouse_cell)
+        return;
+    m_mouse_cell = cell;
+    if (m_mouse.enabled()) {
+        // Reported on next update, further motion until then is merged
+        m_mouse.motion(cell);
+        view.window()->wakeup();
+    }
+}
+
+
+bool Terminal::mouse_button_event(View& view, const MouseBtnEvent& ev)
+{
+    const auto cell = cell_at(ev.pos);
+    m_mouse_cell = cell;
+    if (!m_mouse.enabled())
+        return false;
+    if (ev.action == Action::Repeat)
+        return true;
+    using Button = MouseReporter::Button;
+    Button button;
+    switch (ev.button) {
+        case MouseButton::Left: button = Button::Left; break;
+        case MouseButton::Middle: button = Button::Middle; break;
+        case MouseButton::Right: button = Button::Right; break;
+        default: return false;  // the encodings have no code for other buttons
+    }
+    m_mouse.button(button, ev.action == Action::Press, cell);
+    view.window()->wakeup();
+    return true;
+}
+
+
+void Terminal::send_mouse_reports(View& view)
+{
+    auto reports = m_mouse.pending();
+    if (reports.empty())
+        return;
+    if (!m_shell.writable()) {
+        // Keep them (and keep merging the motion) until the application catches up
+        m_shell.notify_writable([window = view.window()] { window->wakeup(); });
+        return;
+    }
+    m_shell.write(reports);
+    m_mouse.clear();
+}
+
+
 void Terminal::decode_input(std::string_view data)
 {
+    if (m_replay_left != 0) {
+        // Output replayed after attaching to the server - don't reply to the queries in it
+        const auto n = std::min(data.size(), m_replay_left);
+        decode(data.substr(0, n));
+        m_replay_left -= n;
+        data.remove_prefix(n);
+        if (data.empty())
+            return;
+    }
+    decode(data);
+}
+
+
+void Terminal::decode(std::string_view data)
+{
+    TERMIC_TRACE_SCOPE("decode_input");
     using S = InputState;
-    for (char c : data) {
+    m_damaged_row = ~0u;
+    if (m_num_keystrokes != 0) {
+        // Any output after keystrokes is considered their echo.
+        // Forget keystrokes which got no echo in time (e.g. password entry).
+        if (Clock::now() - m_keystrokes[m_num_keystrokes - 1] > c_echo_timeout)
+            m_num_keystrokes = 0;
+        else
+            m_echo_decoded = true;
+    }
+    for (size_t i = 0; i != data.size(); ++i) {
+        const char c = data[i];
         switch (m_input_state) {
             case S::Normal:
+                if (c >= 0 && c < 32 && c != 27)
+                    ++m_counters.control;
                 switch (c) {
                     case 7:   // BEL
                         bell();
@@ -163,31 +329,60 @@ void Terminal::decode_input(std::string_view data)
                     case 9:   // HT
                         m_input_text += "   ";
                         break;
-                    case 10:  // LF
-                        // cursor down / new line
-                        flush_text();
-                        set_cursor_pos(cursor_pos() + Vec2u{0, 1});
-                        break;
-                    case 13:  // CR
-                        // cursor to line beginning
+                    case 10:    // LF - cursor down / new line
+                    case 13: {  // CR - cursor to line beginning
+                        // Collapse whole run of CR / LF into single cursor move,
+                        // i.e. "\r\n" is a single move and "\n\n\n" scrolls once by 3 lines.
+                        // LF doesn't change the column, so the result is the same.
+                        // TODO: Each line of text still goes through add_text and its own
+                        //       cursor move. Appending many lines at once and committing
+                        //       lines scrolled off the page directly to scrollback
+                        //       needs support in TextTerminal's Buffer.
                         flush_text();
-                        set_cursor_pos({0, cursor_pos().y});
+                        const size_t start = i;
+                        unsigned lines = 0;
+                        bool carriage_return = false;
+                        for (; i != data.size() && (data[i] == '\n' || data[i] == '\r'); ++i) {
+                            if (data[i] == '\n')
+                                ++lines;
+                            else
+                                carriage_return = true;
+                        }
+                        m_counters.control += i - start - 1;  // the first one was counted above
+                        --i;  // the for loop will increment it
+                        auto pos = cursor_pos();
+                        set_cursor_pos({carriage_return ? 0 : pos.x, pos.y + lines});
                         break;
+                    }
                     case 27:  // ESC
                         m_input_seq += c;
                         m_input_state = S::Escape;
                         break;
                     default:
-                        if (c >= 0 && c < 32)
-                            log::debug("Unknown cc: {}", int(c));
-                        else
-                            m_input_text += c;
+                        if (c >= 0 && c < 32) {
+                            m_unknown_seqs.add(UnknownSeq::Control, 0, unsigned(c));
+                            TERMIC_DEBUG("Unknown cc: {}", int(c));
+                        } else {
+                            // Handle whole run of text at once. Write it directly,
+                            // unless there is some pending text already. Only a partial
+                            // UTF-8 char at the end of data needs to be kept for later.
+                            size_t end = i + 1;
+                            while (end != data.size() && !(data[end] >= 0 && data[end] < 32))
+                                ++end;
+                            auto run = data.substr(i, end - i);
+                            if (m_input_text.empty())
+                                run.remove_prefix(write_text(run));
+                            m_input_text.append(run);
+                            i = end - 1;
+                        }
                         break;
                 }
                 break;
 
             case S::Escape:
                 m_input_seq += c;
+                if (c != '[' && c != ']' && c != '\\')
+                    ++m_counters.escape;
                 switch (c) {
                     case 27: {  // ESC
                         m_input_seq.clear();
@@ -226,13 +421,26 @@ void Terminal::decode_input(std::string_view data)
                         set_cursor_pos(cursor_pos() - Vec2u{0, 1});
                         break;
                     case '[':
+                        m_cseq_params.clear();
                         m_input_state = S::CSI;
                         break;
                     case ']':
+                        m_osc.clear();
                         m_input_state = S::OSC;
                         break;
+                    case 'P':  // DCS - Device Control String
+                    case 'X':  // SOS - Start of String
+                    case '^':  // PM - Privacy Message
+                    case '_':  // APC - Application Program Command
+                        m_input_state = S::ControlString;
+                        break;
+                    case '\\':  // ST - String Terminator (after OSC)
+                        m_input_seq.clear();
+                        m_input_state = S::Normal;
+                        break;
                     default:
-                        log::debug("Unknown seq: ESC {}", c);
+                        m_unknown_seqs.add(UnknownSeq::Escape, c);
+                        TERMIC_DEBUG("Unknown seq: ESC {}", c);
                         m_input_seq.clear();
                         m_input_state = S::Normal;
                         break;
@@ -254,54 +462,132 @@ void Terminal::decode_input(std::string_view data)
                     flush_text();
                     set_cursor_pos({0, 0});
                 } else {
-                    log::debug("Unknown seq: ESC {} {}", m_input_seq.back(), c);
+                    m_unknown_seqs.add(UnknownSeq::Escape_1, c, unsigned(prev));
+                    TERMIC_DEBUG("Unknown seq: ESC {} {}", m_input_seq.back(), c);
                 }
                 m_input_seq.clear();
                 m_input_state = S::Normal;
                 break;
             }
             case S::CSI: {
-                m_input_seq += c;
                 if (c >= '0' && c <= '?') {
                     // continue reading parameters
+                    m_cseq_params.feed(c);
                     break;
                 }
                 flush_text();
-                // Remove CSI at start and command char at the end
-                std::string_view params = m_input_seq;
-                params.remove_prefix(2);
-                params.remove_suffix(1);
-                TRACE("CSI {} {}", params, c);
-                if (!params.empty() && (
-                        (params.front() >= '\x3c' && params.front() <= '\x3f') ||
-                        (params.back() >= 'p' && params.back() <= '~'))) {
+                ++m_counters.csi;
+                TRACE("CSI {} {}", m_cseq_params, c);
+                if (m_cseq_params.invalid()) {
+                    m_unknown_seqs.add(UnknownSeq::InvalidCSI, c);
+                    TERMIC_DEBUG("Invalid seq: CSI {} {}", m_cseq_params, c);
+                } else if (m_cseq_params.marker() != 0) {
                     // private use
-                    decode_private(c, params);
+                    decode_private(c, m_cseq_params);
                 } else {
-                    decode_ctlseq(c, params);
+                    decode_ctlseq(c, m_cseq_params);
                 }
+                m_cseq_params.clear();
                 m_input_seq.clear();
                 m_input_state = S::Normal;
                 break;
             }
 
             case S::OSC:  // Operating System Command
-                m_input_seq += c;
-                if ((c >= '\x08' && c <= '\x0d') || (c >= ' ' && c <= '~')) {
-                    // continue reading OSC control string
+                switch (c) {
+                    case 7:    // BEL
+                    case 27:   // ESC - ST is "ESC \", the backslash is consumed in Escape state
+                        flush_text();
+                        finish_osc();
+                        m_input_seq.clear();
+                        m_input_state = S::Normal;
+                        if (c == 27) {
+                            m_input_seq += c;
+                            m_input_state = S::Escape;
+                        }
+                        break;
+                    case 24:   // CAN
+                    case 26:   // SUB
+                        m_input_seq.clear();
+                        m_input_state = S::Normal;
+                        break;
+                    default:
+                        m_osc.feed(c);
+                        break;
+                }
+                break;
+
+            case S::ControlString: {
+                // Not supported (e.g. Sixel or kitty graphics) - skip the whole payload
+                // at once, up to the terminator. The first byte identifies the protocol
+                // (e.g. 'G' for kitty graphics), keep it for the stats.
+                if (m_input_seq.size() == 2 && c != 27 && c != 24 && c != 26)
+                    m_input_seq += c;
+                const auto end = data.find_first_of("\x1b\x18\x1a", i);  // ESC, CAN, SUB
+                if (end == std::string_view::npos) {
+                    i = data.size() - 1;
                     break;
                 }
-                log::debug("Unknown seq: OSC {} {}", m_input_seq.substr(2), int(c));
+                i = end;
+                m_unknown_seqs.add(UnknownSeq::ControlString, m_input_seq[1],
+                                   m_input_seq.size() > 2 ? unsigned(uint8_t(m_input_seq[2])) : 0);
                 m_input_seq.clear();
                 m_input_state = S::Normal;
+                if (data[i] == 27) {  // ST is "ESC \", the backslash is consumed in Escape state
+                    m_input_seq += data[i];
+                    m_input_state = S::Escape;
+                }
                 break;
+            }
         }
     }
     flush_text();
+    m_unknown_seqs.dump_if_due();
+}
+
+
+void Terminal::reply(std::string_view data)
+{
+    if (m_replay_left == 0)
+        m_shell.reply(data);
 }
 
 
-void Terminal::decode_ctlseq(char c, std::string_view params)
+void Terminal::finish_osc()
+{
+    using Cmd = OscParser::Command;
+    ++m_counters.osc;
+    if (m_osc.overflow() || m_osc.invalid()) {
+        TERMIC_DEBUG("OSC {}: {}", m_osc.number(), m_osc.overflow() ? "too long" : "invalid");
+        return;
+    }
+    switch (m_osc.command()) {
+        case Cmd::Title:
+            m_title.assign(m_osc.payload());
+            TERMIC_DEBUG("Terminal: title = {}", m_title);
+            break;
+        case Cmd::Hyperlink:
+            // Recognized, but the cells can't carry the link - the text is shown plain
+            TERMIC_DEBUG("Terminal: hyperlink = {}", m_osc.hyperlink_uri());
+            break;
+        case Cmd::Clipboard:
+            // Reading the clipboard is not allowed, it would leak it to any program
+            if (m_osc.clipboard_query())
+                break;
+            // Applied in draw, where the window is accessible
+            m_clipboard.assign(m_osc.payload());
+            m_clipboard_pending = true;
+            break;
+        case Cmd::None:
+        case Cmd::Unknown:
+            m_unknown_seqs.add(UnknownSeq::OSC, 0, m_osc.number());
+            TERMIC_DEBUG("Unknown seq: OSC {}", m_osc.number());
+            break;
+    }
+}
+
+
+void Terminal::decode_ctlseq(char c, const CseqParams& params)
 {
     switch (c) {
         case 'A': {  // CUU - Cursor Up
@@ -344,6 +630,7 @@ void Terminal::decode_ctlseq(char c, std::string_view params)
         case 'J': {  // ED - Erase in Page (Display)
             unsigned p = 0;
             cseq_parse_params("ED", params, p);
+            m_counters.damaged_lines += size_in_cells().y;
             switch (p) {
                 case 0:
                     // erase from cursor to the end of page
@@ -363,7 +650,8 @@ void Terminal::decode_ctlseq(char c, std::string_view params)
                     erase_buffer();
                     break;
                 default:
-                    log::warning("Unknown ED param: {}", p);
+                    m_unknown_seqs.add(UnknownSeq::CSI, c, p);
+                    TERMIC_DEBUG("Unknown ED param: {}", p);
                     break;
             }
             break;
@@ -371,6 +659,7 @@ void Terminal::decode_ctlseq(char c, std::string_view params)
         case 'K': {  // EL - Erase in Line
             unsigned p = 0;
             cseq_parse_params("EL", params, p);
+            ++m_counters.damaged_lines;
             switch (p) {
                 case 0:
                     // clear from cursor to the end of the line
@@ -385,7 +674,8 @@ void Terminal::decode_ctlseq(char c, std::string_view params)
                     erase_in_line(0, 0);
                     break;
                 default:
-                    log::warning("Unknown EL param: {}", p);
+                    m_unknown_seqs.add(UnknownSeq::CSI, c, p);
+                    TERMIC_DEBUG("Unknown EL param: {}", p);
                     break;
             }
             break;
@@ -399,19 +689,39 @@ void Terminal::decode_ctlseq(char c, std::string_view params)
         case 'X': {  // ECH - Erase Character
             unsigned p = 1;
             cseq_parse_params("ECH", params, p);
-            std::string spaces(p, ' ');
-            current_line().add_text(cursor_pos().x, spaces, /*attr=*/{}, /*insert=*/false);
+            auto x = cursor_pos().x;
+            auto width = size_in_cells().x;
+            p = x < width ? std::min(p, width - x) : 0;
+            repeat_char(" ", p, [this, &x](std::string_view chunk, unsigned n) {
+                current_line().add_text(x, chunk, /*attr=*/{}, /*insert=*/false);
+                x += n;
+            });
+            break;
+        }
+        case 'b': {  // REP - Repeat (preceding graphic character)
+            unsigned p = 1;
+            cseq_parse_params("REP", params, p);
+            if (m_last_char_len == 0)
+                break;
+            // limit the repetition to one page, anything more would be overwritten anyway
+            auto page = size_in_cells();
+            p = std::min(p, page.x * page.y);
+            repeat_char({m_last_char.data(), m_last_char_len}, p,
+                        [this](std::string_view chunk, unsigned) {
+                add_text(chunk, m_mode.insert, m_mode.autowrap);
+            });
             break;
         }
         case 'c':  {  // DA - Device Attributes
             unsigned p = 0;
             cseq_parse_params("DA", params, p);
             if (p != 0) {
-                log::debug("Unknown DA params: {}{}", p, params);
+                m_unknown_seqs.add(UnknownSeq::CSI, c, p);
+                TERMIC_DEBUG("Unknown DA params: {}", params);
                 break;
             }
             // Say we are "VT100 with Advanced Video Option"
-            m_shell.write("\033[?1;2c");
+            reply("\033[?1;2c");
             break;
         }
         case 'd': {  // VPA - Line Position Absolute
@@ -440,7 +750,8 @@ void Terminal::decode_ctlseq(char c, std::string_view params)
                     m_mode.insert = true;
                     break;
                 default:
-                    log::debug("Unknown SM param: {}", p);
+                    m_unknown_seqs.add(UnknownSeq::Mode, c, p);
+                    TERMIC_DEBUG("Unknown SM param: {}", p);
                     break;
             }
             break;
@@ -453,7 +764,8 @@ void Terminal::decode_ctlseq(char c, std::string_view params)
                     m_mode.insert = false;
                     break;
                 default:
-                    log::debug("Unknown RM param: {}", p);
+                    m_unknown_seqs.add(UnknownSeq::Mode, c, p);
+                    TERMIC_DEBUG("Unknown RM param: {}", p);
                     break;
             }
             break;
@@ -467,188 +779,259 @@ void Terminal::decode_ctlseq(char c, std::string_view params)
             unsigned bottom = 0;
             cseq_parse_params("DECSTBM", params, top, bottom);
             set_cursor_pos({0, 0});
-            log::debug("DECSTBM (Set Scrolling Region): {} {} (not implemented)", top, bottom);
+            m_unknown_seqs.add(UnknownSeq::CSI, c, top);
+            TERMIC_DEBUG("DECSTBM (Set Scrolling Region): {} {} (not implemented)", top, bottom);
             break;
         }
         default:
-            log::debug("Unknown seq: CSI {} {}", params, c);
+            m_unknown_seqs.add(UnknownSeq::CSI, c, params.get(0, 0));
+            TERMIC_DEBUG("Unknown seq: CSI {} {}", params, c);
             break;
     }
 }
 
 
-void Terminal::decode_sgr(std::string_view params)
+void Terminal::decode_sgr(const CseqParams& params)
 {
-    bool more_params = true;
-    while (more_params) {
-        unsigned p = 0;
-        more_params = cseq_next_param(params, p);
-
-        if (p == 0) {
-            // reset all attributes
-            set_fg(c_fg_default);
-            set_bg(c_bg_default);
-            set_font_style(FontStyle::Regular);
-            set_decoration(Decoration::None);
-            set_mode(Mode::Normal);
-        } else if (p == 1) {
-            set_font_style(FontStyle::Bold);
-            set_mode(Mode::Bright);
-        } else if (p >= 30 && p <= 37) {
-            set_fg(Color4bit(p - 30));
-        } else if (p == 38 && more_params) {
-            // Note that this is semicolon-separated xterm-compatible format.
-            // According to ITU T.416, the parameter list should be colon separated
-            // and should include color space identifier for RGB:
-            //   "\e[38;2:<color-space-id>:<r>:<g>:<b>m"
-            //   "\e[38;5:<index>m"
-            // This is what we accept instead (xterm compatibility):
-            //   "\e[38;2;<r>;<g>;<b>m"
-            //   "\e[38;5;<index>m"
-            // There is also hybrid colon-separated-but-colorspace-less format.
-            // Let's ignore both that and the original standard - nobody use those.
-            unsigned p1 = 0;
-            more_params = cseq_next_param(params, p1);
-            if (p1 == 5 && more_params) {
-                // 8-bit color
-                unsigned idx = 0;
-                more_params = cseq_next_param(params, idx);
-                set_fg(Color8bit(idx));
-            } else if (p1 == 2 && more_params) {
-                // 24-bit color
-                unsigned r = 0, g = 0, b = 0;
-                more_params =
-                        cseq_next_param(params, r) &&
-                        cseq_next_param(params, g) &&
-                        cseq_next_param(params, b);
-                set_fg(Color24bit(uint8_t(r), uint8_t(g), uint8_t(b)));
-            } else {
-                log::debug("Unknown SGR {};{}", p, p1);
-            }
-        } else if (p == 39) {
-            set_fg(c_fg_default);
-        } else if (p >= 40 && p <= 47) {
-            set_bg(Color4bit(p - 40));
-        } else if (p == 48 && more_params) {
-            unsigned p1 = 0;
-            more_params = cseq_next_param(params, p1);
-            if (p1 == 5 && more_params) {
-                // 8-bit color
-                unsigned idx = 0;
-                more_params = cseq_next_param(params, idx);
-                set_bg(Color8bit(idx));
-            } else if (p1 == 2 && more_params) {
-                // 24-bit color
-                unsigned r = 0, g = 0, b = 0;
-                more_params =
-                        cseq_next_param(params, r) &&
-                        cseq_next_param(params, g) &&
-                        cseq_next_param(params, b);
-                set_bg(Color24bit(uint8_t(r), uint8_t(g), uint8_t(b)));
-            } else {
-                log::debug("Unknown SGR {};{}", p, p1);
-            }
-        } else if (p == 49) {
-            set_bg(c_bg_default);
-        } else if (p >= 90 && p <= 97) {
-            set_fg(Color4bit(p - 90 + 8));
-        } else if (p >= 100 && p <= 107) {
-            set_bg(Color4bit(p - 100 + 8));
-        } else {
-            log::debug("Unknown SGR {}", p);
+    TERMIC_TRACE_SCOPE("decode_sgr");
+    // Resolve whole SGR sequence to new attributes first,
+    // then apply them at once (only what actually changed)
+    SgrAttributes attrs = m_attrs;
+    apply_sgr(attrs, params, &m_unknown_seqs);
+    set_attributes(attrs);
+}
+
+
+void Terminal::set_attributes(const SgrAttributes& attrs)
+{
+    if (attrs == m_attrs)
+        return;
+
+    auto set_color = [](const SgrColor& color, auto&& set) {
+        switch (color.kind) {
+            case SgrColor::Kind::Color4bit: set(Color4bit(color.r)); break;
+            case SgrColor::Kind::Color8bit: set(Color8bit(color.r)); break;
+            case SgrColor::Kind::Color24bit: set(Color24bit(color.r, color.g, color.b)); break;
         }
+    };
+    if (attrs.fg != m_attrs.fg)
+        set_color(attrs.fg, [this](auto c) { set_fg(c); });
+    if (attrs.bg != m_attrs.bg)
+        set_color(attrs.bg, [this](auto c) { set_bg(c); });
+    if (attrs.bold != m_attrs.bold) {
+        set_font_style(attrs.bold ? FontStyle::Bold : FontStyle::Regular);
+        set_mode(attrs.bold ? Mode::Bright : Mode::Normal);
     }
+    if (attrs.underline != m_attrs.underline)
+        set_decoration(attrs.underline ? Decoration::Underlined : Decoration::None);
+
+    m_attrs = attrs;
 }
 
 
-void Terminal::decode_private(char f, std::string_view params)
+void Terminal::decode_private(char f, const CseqParams& params)
 {
-    if (!params.empty() && params[0] == '?' && (f == 'h' || f == 'l')) {
-        // DECSET - DEC Private Mode Set [CSI ? <mode> h]
-        // DECRST - DEC Private Mode Reset [CSI ? <mode> l]
+    if (params.marker() == '?' && (f == 'h' || f == 'l')) {
+        // DECSET - DEC Private Mode Set [CSI ? <mode> ; ... h]
+        // DECRST - DEC Private Mode Reset [CSI ? <mode> ; ... l]
         bool mode_set = bool(f == 'h');
-        unsigned mode = 0;
-        params.remove_prefix(1);
-        cseq_parse_params(mode_set ? "DECSET" : "DECRST", params, mode);
-        switch (mode) {
-            case 1:
-                // DECCKM - Cursor Keys Mode
-                m_mode.app_cursor_keys = mode_set;
-                break;
-            case 3:
-                // DECCOLM - 80 / 132 Column Mode
-                log::debug("Terminal: request for {} column mode ignored",
-                          (mode_set ? 132u : 80u));
-                //set_req_cells({mode_set ? 132u : 80u, req_cells().y});
-                return;
-            case 7:
-                // DECAWM - Autowrap Mode
-                m_mode.autowrap = mode_set;
-                break;
-            case 47:
-                // Normal / Alternate Screen Buffer (xterm)
-                if (mode_set != m_mode.alternate_screen_buffer) {
-                    auto orig_cursor = cursor_pos();
-                    m_alternate_buffer = set_buffer(std::move(m_alternate_buffer));
-                    set_cursor_pos(m_saved_cursor);
-                    m_saved_cursor = orig_cursor;
-                }
-                m_mode.alternate_screen_buffer = mode_set;
-                return;
-            case 1048:
-                if (mode_set) {
-                    // Save cursor as in DECSC (xterm)
-                    m_saved_cursor = cursor_pos();
-                } else {
-                    // Restore cursor as in DECRC (xterm)
-                    set_cursor_pos(m_saved_cursor);
-                }
-                return;
-            case 1049:
-                if (mode_set && !m_mode.alternate_screen_buffer) {
-                    // Save cursor as in DECSC (xterm)
-                    // After saving the cursor, switch to the Alternate Screen Buffer,
-                    // clearing it first.
-                    m_mode.alternate_screen_buffer = true;
-                    m_saved_cursor = cursor_pos();
-                    m_alternate_buffer = set_buffer(std::move(m_alternate_buffer));
-                    erase_buffer();
-                }
-                if (!mode_set && m_mode.alternate_screen_buffer) {
-                    // Use Normal Screen Buffer and restore cursor as in DECRC (xterm)
-                    m_mode.alternate_screen_buffer = false;
-                    m_alternate_buffer = set_buffer(std::move(m_alternate_buffer));
-                    set_cursor_pos(m_saved_cursor);
-                }
-                return;
-            case 2004:
-                // bracketed paste mode
-                m_mode.bracketed_paste = mode_set;
-                log::debug("Terminal: bracketed_paste_mode = {}",
-                          bool(m_mode.bracketed_paste));
-                return;
-            default:
-                log::debug("Unknown DECSET/DECRST: {} {}", mode, f);
-                return;
+        for (unsigned i = 0; i < params.size(); ++i)
+            set_private_mode(params.get(i, 0), mode_set);
+        return;
+    }
+    m_unknown_seqs.add(UnknownSeq::PrivateCSI, f, unsigned(params.marker()));
+    TERMIC_DEBUG("Unknown private seq: CSI {} {}", params, f);
+}
+
+
+void Terminal::set_private_mode(unsigned mode, bool mode_set)
+{
+    switch (mode) {
+        case 1:
+            // DECCKM - Cursor Keys Mode
+            m_mode.app_cursor_keys = mode_set;
+            break;
+        case 3:
+            // DECCOLM - 80 / 132 Column Mode
+            TERMIC_DEBUG("Terminal: request for {} column mode ignored",
+                         (mode_set ? 132u : 80u));
+            //set_req_cells({mode_set ? 132u : 80u, req_cells().y});
+            break;
+        case 7:
+            // DECAWM - Autowrap Mode
+            m_mode.autowrap = mode_set;
+            break;
+        case 47:
+            // Normal / Alternate Screen Buffer (xterm)
+            if (mode_set != m_mode.alternate_screen_buffer) {
+                auto orig_cursor = cursor_pos();
+                m_alternate_buffer = set_buffer(std::move(m_alternate_buffer));
+                set_cursor_pos(m_saved_cursor);
+                m_saved_cursor = orig_cursor;
+            }
+            m_mode.alternate_screen_buffer = mode_set;
+            break;
+        case 1048:
+            if (mode_set) {
+                // Save cursor as in DECSC (xterm)
+                m_saved_cursor = cursor_pos();
+            } else {
+                // Restore cursor as in DECRC (xterm)
+                set_cursor_pos(m_saved_cursor);
+            }
+            break;
+        case 1049:
+            if (mode_set && !m_mode.alternate_screen_buffer) {
+                // Save cursor as in DECSC (xterm)
+                // After saving the cursor, switch to the Alternate Screen Buffer,
+                // clearing it first.
+                m_mode.alternate_screen_buffer = true;
+                m_saved_cursor = cursor_pos();
+                m_alternate_buffer = set_buffer(std::move(m_alternate_buffer));
+                erase_buffer();
+            }
+            if (!mode_set && m_mode.alternate_screen_buffer) {
+                // Use Normal Screen Buffer and restore cursor as in DECRC (xterm)
+                m_mode.alternate_screen_buffer = false;
+                m_alternate_buffer = set_buffer(std::move(m_alternate_buffer));
+                set_cursor_pos(m_saved_cursor);
+            }
+            break;
+        case 1000:
+        case 1002:
+        case 1003: {
+            // Mouse tracking: buttons only / also drag / any motion (xterm)
+            using Tracking = MouseReporter::Tracking;
+            const Tracking tracking = mode == 1000 ? Tracking::Buttons
+                                    : mode == 1002 ? Tracking::Drag
+                                    : Tracking::Motion;
+            m_mouse.set_tracking(mode_set ? tracking : Tracking::Off);
+            break;
         }
+        case 1006:
+            // SGR mouse mode (xterm)
+            m_mouse.set_sgr(mode_set);
+            break;
+        case 2004:
+            // bracketed paste mode
+            m_mode.bracketed_paste = mode_set;
+            TERMIC_DEBUG("Terminal: bracketed_paste_mode = {}",
+                         bool(m_mode.bracketed_paste));
+            break;
+        default:
+            m_unknown_seqs.add(UnknownSeq::PrivateMode, mode_set ? 'h' : 'l', mode);
+            TERMIC_DEBUG("Unknown DECSET/DECRST: {} {}", mode, mode_set ? 'h' : 'l');
+            break;
     }
-    log::debug("Unknown private seq {}", params);
 }
 
 
 void Terminal::flush_text()
 {
     if (!m_input_text.empty()) {
-        std::string_view sv(m_input_text);
-        // Check if there is partial UTF-8 character at the end
-        size_t partial = utf8_partial_end(sv);
-        if (sv.size() == partial)
-            return;
-        sv.remove_suffix(partial);
-        TRACE("flush_text {} (insert={})", text, bool(m_mode.insert));
+        auto written = write_text(m_input_text);
+        m_input_text.erase(0, written);
+    }
+}
+
+
+size_t Terminal::write_text(std::string_view sv)
+{
+    TERMIC_TRACE_SCOPE("flush_text");
+    // Check if there is partial UTF-8 character at the end
+    size_t partial = utf8_partial_end(sv);
+    if (sv.size() == partial)
+        return 0;
+    sv.remove_suffix(partial);
+    TRACE("flush_text {} (insert={})", sv, bool(m_mode.insert));
+    m_counters.text_bytes += sv.size();
+    if (cursor_pos().y != m_damaged_row) {
+        m_damaged_row = cursor_pos().y;
+        ++m_counters.damaged_lines;
+    }
+    if (ascii_prefix(sv) == sv.size()) {
         add_text(sv, m_mode.insert, m_mode.autowrap);
-        m_input_text.erase(0, sv.size());
+        set_last_char(sv.substr(sv.size() - 1));
+    } else
+        write_unicode_text(sv);
+    return sv.size();
+}
+
+
+void Terminal::write_unicode_text(std::string_view sv)
+{
+    // Write pending run of valid narrow chars, remember the last one for REP
+    // (`last` is where it starts, including its combining marks)
+    auto write_run = [this, sv](size_t start, size_t end, size_t last) {
+        if (start == end)
+            return;
+        add_text(sv.substr(start, end - start), m_mode.insert, m_mode.autowrap);
+        set_last_char(sv.substr(last, end - last));
+    };
+    // Zero width chars (combining marks, ZWJ, variation selectors) have no cell
+    // of their own, they are kept with the preceding char. C1 controls are dropped.
+    auto is_zero_width = [](char32_t cp) {
+        return cp != utf8_invalid && cp >= 0xA0 && char_width(cp) == 0;
+    };
+    size_t run = 0;
+    size_t i = ascii_prefix(sv);
+    size_t last = i == 0 ? 0 : i - 1;
+    while (i != sv.size()) {
+        char32_t cp;
+        const size_t len = utf8_decode(sv.substr(i), cp);
+        const unsigned width = cp == utf8_invalid ? 1 : char_width(cp);
+        if ((width == 1 && cp != utf8_invalid) || is_zero_width(cp)) {
+            if (width == 1)
+                last = i;
+            i += len;
+            if (const auto ascii = ascii_prefix(sv.substr(i)); ascii != 0) {
+                i += ascii;
+                last = i - 1;
+            }
+            continue;
+        }
+        write_run(run, i, last);
+        size_t end = i + len;
+        if (cp == utf8_invalid) {
+            set_last_char("\xEF\xBF\xBD");
+            add_text("\xEF\xBF\xBD", m_mode.insert, m_mode.autowrap);
+        } else if (width == 2) {
+            // Doesn't fit in the last column - wrap it whole, like the application expects
+            if (m_mode.autowrap && cursor_pos().x + 1 == size_in_cells().x)
+                add_text(" ", m_mode.insert, true);
+            // The combining marks go before the padding (if they fit in the cell buffer)
+            char cell[c_max_cell];
+            for (char32_t next; end != sv.size(); ) {
+                const size_t n = utf8_decode(sv.substr(end), next);
+                if (!is_zero_width(next) || end + n - i >= sizeof(cell))
+                    break;
+                end += n;
+            }
+            // The glyph overflows into the following cell, fill it with a space,
+            // so the following text is placed where the application expects it
+            const size_t cell_len = end - i;
+            std::memcpy(cell, sv.data() + i, cell_len);
+            cell[cell_len] = ' ';
+            set_last_char({cell, cell_len + 1});
+            add_text({cell, cell_len + 1}, m_mode.insert, m_mode.autowrap);
+        }
+        i = end;
+        run = i;
+        last = i;
+    }
+    write_run(run, i, last);
+}
+
+
+void Terminal::set_last_char(std::string_view cell)
+{
+    if (cell.size() > m_last_char.size()) {
+        // Too many combining marks, keep just the base char
+        char32_t cp;
+        cell = cell.substr(0, utf8_decode(cell, cp));
     }
+    m_last_char_len = uint8_t(std::min(cell.size(), m_last_char.size()));
+    std::copy_n(cell.begin(), m_last_char_len, m_last_char.begin());
 }
 
 
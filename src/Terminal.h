@@ -7,12 +7,20 @@
 #define XCITERM_TERMINAL_H
 
 #include "Shell.h"
+#include "MouseReporter.h"
+#include "OscParser.h"
+#include "SgrAttributes.h"
+#include "utility.h"
+#include "UnknownSeqStats.h"
+#include "PerfStats.h"
 #include <xci/widgets/TextTerminal.h>
 #include <xci/widgets/Widget.h>
 #include <xci/graphics/Window.h>
 #include <xci/core/dispatch.h>
 
 #include <string_view>
+#include <array>
+#include <chrono>
 
 namespace xci::term {
 
@@ -20,33 +28,88 @@ namespace xci::term {
 // For multi-terminal program (e.g. tabbed view), multiple instances have to be created.
 class Terminal: public widgets::TextTerminal {
     using Buffer = widgets::terminal::Buffer;
+    using UnknownSeq = UnknownSeqStats::Kind;
 
 public:
     explicit Terminal(widgets::Theme& theme, Shell& shell)
-        : widgets::TextTerminal(theme), m_shell(shell) { m_mode.autowrap = true; }
+        : widgets::TextTerminal(theme), m_shell(shell),
+          m_attrs(sgr_default)
+    {
+        m_mode.autowrap = true;
+    }
 
     void resize(graphics::View& view) override;
+    void draw(graphics::View& view) override;
+
+    // Send the new window size to the shell, once the resizing settles.
+    // Dragging the window resizes it every frame, each SIGWINCH would make
+    // the application redraw the whole screen. Call this on each update.
+    void update_winsize(graphics::View& view);
+
+    // Write out the mouse reports (mouse tracking mode), at most once per frame
+    // and only when the shell is reading its input. Call this on each update.
+    void send_mouse_reports(graphics::View& view);
 
     bool key_event(graphics::View& view, const graphics::KeyEvent& ev) override;
     void char_event(graphics::View& view, const graphics::CharEvent& ev) override;
     void scroll_event(graphics::View& view, const graphics::ScrollEvent& ev) override;
+    void mouse_pos_event(graphics::View& view, const graphics::MousePosEvent& ev) override;
+    bool mouse_button_event(graphics::View& view, const graphics::MouseBtnEvent& ev) override;
 
     // Decode input from shell. Data are mix of UTF-8 text,
     // control codes and escape sequences. This will call
     // other methods like add_text, set_color for each fragment of data.
     void decode_input(std::string_view data);
 
+    // Low latency mode: don't draw a frame right after a keystroke,
+    // draw the frame with its echo as soon as it arrives instead.
+    void set_low_latency(bool enabled) { m_low_latency = enabled; }
+    bool low_latency() const { return m_low_latency; }
+
+    // Fast-forward: when more than this number of bytes is waiting to be decoded,
+    // decode all of it (up to the time budget) before drawing next frame.
+    static constexpr unsigned fast_forward_screens = 4;
+    static constexpr auto fast_forward_budget = std::chrono::milliseconds(50);
+    size_t fast_forward_threshold() const {
+        auto page = size_in_cells();
+        return size_t(fast_forward_screens) * page.x * page.y;
+    }
+
+    // Window title, as set by OSC 0 / OSC 2
+    const std::string& title() const { return m_title; }
+
+    // Performance statistics of this terminal
+    PerfStats& perf_stats() { return m_perf_stats; }
+    const DecodeCounters& decode_counters() const { return m_counters; }
+
 private:
 
-    void decode_ctlseq(char c, std::string_view params);
-    void decode_sgr(std::string_view params);
-    void decode_private(char f, std::string_view params);
+    void decode_ctlseq(char c, const CseqParams& params);
+    void decode_sgr(const CseqParams& params);
+    void set_attributes(const SgrAttributes& attrs);
+    void decode_private(char f, const CseqParams& params);
+    void finish_osc();
+    void set_private_mode(unsigned mode, bool mode_set);
     void flush_text();
+    size_t write_text(std::string_view sv);  // returns number of bytes written
+    void write_unicode_text(std::string_view sv);
+    void set_last_char(std::string_view cell);
+    MouseReporter::Pos cell_at(core::Vec2f pos) const;
+    void input_written(graphics::View& view);
+    void decode(std::string_view data);
+    void reply(std::string_view data);
 
 private:
     Shell& m_shell;
+    size_t m_replay_left = m_shell.replay_size();  // output replayed by server, not yet decoded
     std::string m_input_text;
 
+    // Last graphic character written by flush_text (UTF-8), for REP.
+    // It includes its combining marks and the padding space of a wide character.
+    static constexpr size_t c_max_cell = max_repeat_char;
+    std::array<char, c_max_cell> m_last_char {};
+    uint8_t m_last_char_len = 0;
+
     // Normal / Alternate Screen Buffer
     // These variables contain state of the *other* buffer.
     // Current buffer and cursor is inside TextTerminal instance.
@@ -59,12 +122,45 @@ private:
         Escape_1,  // single argument escape sequences
         CSI,
         OSC,
+        ControlString,  // DCS, SOS, PM, APC
     };
     InputState m_input_state = InputState::Normal;
     std::string m_input_seq;
-
-    static constexpr Color4bit c_fg_default = Color4bit::White;
-    static constexpr Color4bit c_bg_default = Color4bit::Black;
+    CseqParams m_cseq_params;
+    OscParser m_osc;
+    UnknownSeqStats m_unknown_seqs;
+
+    PerfStats m_perf_stats;
+    DecodeCounters m_counters;
+    unsigned m_damaged_row = ~0u;  // last row counted in m_counters.damaged_lines
+
+    // Keystroke-to-photon latency measurement
+    using Clock = std::chrono::steady_clock;
+    static constexpr auto c_echo_timeout = std::chrono::milliseconds(500);
+    std::array<Clock::time_point, 16> m_keystrokes;  // pending keystrokes (waiting for echo)
+    unsigned m_num_keystrokes = 0;
+    bool m_echo_decoded = false;  // some output was decoded after the keystrokes
+    bool m_low_latency = false;
+    bool m_scrolled_back = false;
+
+    // Window size, as known by the shell
+    static constexpr auto c_resize_settle = std::chrono::milliseconds(100);
+    core::Vec2u m_winsize;
+    Clock::time_point m_resized;  // last resize, while not yet sent
+    bool m_winsize_pending = false;
+
+    // Graphic rendition (SGR) - the current attributes
+    SgrAttributes m_attrs;
+
+    // Mouse tracking (DECSET 1000 etc.)
+    MouseReporter m_mouse;
+    MouseReporter::Pos m_mouse_cell;
+    float m_wheel = 0;  // scroll offset not yet reported
+
+    // Operating System Commands
+    std::string m_title;
+    std::string m_clipboard;  // OSC 52, waiting for draw
+    bool m_clipboard_pending = false;
 
     // modes
     struct {
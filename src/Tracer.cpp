@@ -0,0 +1,170 @@
+// Tracer.cpp created on 2026-10-19
+// This file is part of Termic project <https://github.com/rbrich/termic>
+// Copyright 2026 Radek Brich
+// Licensed under the Apache License, Version 2.0 (see LICENSE file)
+
+#include "Tracer.h"
+#include <xci/core/log.h>
+#include <fmt/format.h>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <cstdio>
+
+namespace xci::term {
+
+using namespace xci::core;
+using namespace std::chrono;
+
+
+namespace {
+
+struct TraceEvent {
+    const char* name;
+    Tracer::Clock::time_point start;
+    Tracer::Clock::time_point end;
+};
+
+// Written only by the owning thread. The size is published with release
+// semantics, so the events below it can be read by stop() from other thread.
+struct ThreadBuffer {
+    explicit ThreadBuffer(unsigned tid) : tid(tid) { events.resize(Tracer::max_events_per_thread); }
+
+    unsigned tid;
+    const char* name = nullptr;
+    std::vector<TraceEvent> events;
+    std::atomic<size_t> size {0};
+    std::atomic<size_t> dropped {0};
+};
+
+struct TraceState {
+    std::mutex mutex;  // guards registration of thread buffers, and the filename
+    std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+    std::string filename;
+    Tracer::Clock::time_point origin;
+};
+
+TraceState& state()
+{
+    static TraceState s;
+    return s;
+}
+
+ThreadBuffer& thread_buffer()
+{
+    thread_local ThreadBuffer* buffer = nullptr;
+    if (!buffer) {
+        auto& s = state();
+        std::lock_guard lock(s.mutex);
+        s.buffers.push_back(std::make_unique<ThreadBuffer>(unsigned(s.buffers.size() + 1)));
+        buffer = s.buffers.back().get();
+    }
+    return *buffer;
+}
+
+void write_json_string(std::FILE* f, const char* str)
+{
+    std::fputc('"', f);
+    for (const char* p = str; *p; ++p) {
+        if (*p == '"' || *p == '\\')
+            std::fputc('\\', f);
+        std::fputc(*p, f);
+    }
+    std::fputc('"', f);
+}
+
+} // namespace
+
+
+std::atomic_bool Tracer::m_enabled {false};
+
+
+void Tracer::start(std::string filename)
+{
+    auto& s = state();
+    {
+        std::lock_guard lock(s.mutex);
+        s.filename = std::move(filename);
+        s.origin = Clock::now();
+    }
+    m_enabled.store(true);
+}
+
+
+bool Tracer::stop()
+{
+    if (!m_enabled.exchange(false))
+        return true;
+
+    auto& s = state();
+    std::lock_guard lock(s.mutex);
+    std::FILE* f = std::fopen(s.filename.c_str(), "w");
+    if (!f) {
+        log::error("Trace: fopen({}): {m}", s.filename);
+        return false;
+    }
+
+    std::fputs("{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n", f);
+    bool first = true;
+    auto separator = [&first, f] {
+        if (!first)
+            std::fputs(",\n", f);
+        first = false;
+    };
+    size_t total = 0;
+    for (const auto& buf : s.buffers) {
+        if (buf->name) {
+            separator();
+            std::fprintf(f, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":", buf->tid);
+            write_json_string(f, buf->name);
+            std::fputs("}}", f);
+        }
+        const size_t size = buf->size.load(std::memory_order_acquire);
+        for (size_t i = 0; i != size; ++i) {
+            const auto& ev = buf->events[i];
+            auto ts = duration<double, std::micro>(ev.start - s.origin).count();
+            auto dur = duration<double, std::micro>(ev.end - ev.start).count();
+            separator();
+            std::fputs("{\"name\":", f);
+            write_json_string(f, ev.name);
+            std::fprintf(f, ",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}",
+                         buf->tid, ts, dur);
+        }
+        total += size;
+        if (auto dropped = buf->dropped.load(); dropped != 0)
+            log::warning("Trace: thread {} dropped {} events (buffer full)", buf->tid, dropped);
+    }
+    std::fputs("\n]}\n", f);
+    const bool ok = std::ferror(f) == 0;
+    std::fclose(f);
+    if (!ok) {
+        log::error("Trace: write error: {}", s.filename);
+        return false;
+    }
+    log::info("Trace: written {} events to {}", total, s.filename);
+    return true;
+}
+
+
+void Tracer::set_thread_name(const char* name)
+{
+    if (!enabled())
+        return;  // don't allocate the buffer
+    thread_buffer().name = name;
+}
+
+
+void Tracer::record(const char* name, Clock::time_point start, Clock::time_point end)
+{
+    auto& buf = thread_buffer();
+    const size_t size = buf.size.load(std::memory_order_relaxed);
+    if (size == buf.events.size()) {
+        buf.dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    buf.events[size] = {name, start, end};
+    buf.size.store(size + 1, std::memory_order_release);
+}
+
+
+} // namespace xci::term
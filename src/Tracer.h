@@ -0,0 +1,81 @@
+// Tracer.h created on 2026-10-19
+// This file is part of Termic project <https://github.com/rbrich/termic>
+// Copyright 2026 Radek Brich
+// Licensed under the Apache License, Version 2.0 (see LICENSE file)
+
+#ifndef XCITERM_TRACER_H
+#define XCITERM_TRACER_H
+
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <cstdint>
+
+namespace xci::term {
+
+
+/// Scoped timing events exported as Chrome trace-event JSON
+/// (opens in chrome://tracing or https://ui.perfetto.dev).
+///
+/// Each thread records into its own fixed-size buffer, without locking.
+/// The buffers are written to the file by `stop()`, which should be called
+/// after the other threads stopped recording (events recorded concurrently
+/// with `stop()` may or may not be written).
+///
+/// When not started, the cost of a trace scope is a single relaxed atomic load.
+class Tracer {
+public:
+    using Clock = std::chrono::steady_clock;
+    static constexpr size_t max_events_per_thread = 1u << 18;
+
+    /// Enable tracing, the events will be written to `filename` by stop().
+    static void start(std::string filename);
+
+    /// Disable tracing and write the recorded events. Returns false on I/O error.
+    static bool stop();
+
+    static bool enabled() { return m_enabled.load(std::memory_order_relaxed); }
+
+    /// Name the current thread in the trace output.
+    static void set_thread_name(const char* name);
+
+    /// Record complete event. `name` must be a string literal (not copied).
+    static void record(const char* name, Clock::time_point start, Clock::time_point end);
+
+private:
+    static std::atomic_bool m_enabled;
+};
+
+
+/// RAII scope, see TERMIC_TRACE_SCOPE
+class TraceScope {
+public:
+    explicit TraceScope(const char* name) : m_name(name) {
+        if (Tracer::enabled())
+            m_start = Tracer::Clock::now();
+    }
+    ~TraceScope() {
+        if (m_start != Tracer::Clock::time_point{})
+            Tracer::record(m_name, m_start, Tracer::Clock::now());
+    }
+
+    TraceScope(const TraceScope&) = delete;
+    TraceScope& operator=(const TraceScope&) = delete;
+
+private:
+    const char* m_name;
+    Tracer::Clock::time_point m_start {};
+};
+
+
+#define TERMIC_TRACE_CONCAT_(a, b) a ## b
+#define TERMIC_TRACE_CONCAT(a, b) TERMIC_TRACE_CONCAT_(a, b)
+
+/// Record the time spent in current scope (if tracing is enabled)
+#define TERMIC_TRACE_SCOPE(name) \
+    ::xci::term::TraceScope TERMIC_TRACE_CONCAT(trace_scope_, __LINE__) {name}
+
+
+} // namespace xci::term
+
+#endif // XCITERM_TRACER_H
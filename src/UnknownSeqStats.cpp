@@ -0,0 +1,96 @@
+// UnknownSeqStats.cpp created on 2026-10-19
+// This file is part of Termic project <https://github.com/rbrich/termic>
+// Copyright 2026 Radek Brich
+// Licensed under the Apache License, Version 2.0 (see LICENSE file)
+
+#include "UnknownSeqStats.h"
+#include <xci/core/log.h>
+#include <fmt/format.h>
+#include <algorithm>
+
+namespace xci::term {
+
+using namespace xci::core;
+
+
+void UnknownSeqStats::count(uint32_t key)
+{
+    constexpr size_t mask = std::tuple_size_v<decltype(m_counts)> - 1;
+    static_assert((mask & (mask + 1)) == 0, "table size must be power of two");
+    for (size_t i = (key * 2654435761u) >> 16;; ++i) {
+        auto& entry = m_counts[i & mask];
+        if (entry.count != 0 && entry.key == key) {
+            ++entry.count;
+            return;
+        }
+        if (entry.count == 0) {
+            if (m_keys == max_keys)
+                break;
+            entry = {key, 1};
+            ++m_keys;
+            return;
+        }
+    }
+    ++m_other;
+}
+
+
+void UnknownSeqStats::dump()
+{
+    if (m_pending == 0)
+        return;
+
+    // Move the used entries to the front and order them by count, in place
+    auto used_end = std::partition(m_counts.begin(), m_counts.end(),
+                                   [](const Entry& e) { return e.count != 0; });
+    auto top_end = m_counts.begin() + std::min(size_t(m_keys), dump_max_entries);
+    std::partial_sort(m_counts.begin(), top_end, used_end,
+                      [](const Entry& a, const Entry& b) { return a.count > b.count; });
+
+    std::string summary;
+    for (auto it = m_counts.begin(); it != top_end; ++it) {
+        if (!summary.empty())
+            summary += ", ";
+        summary += fmt::format("{} ({}x)", describe(it->key), it->count);
+    }
+    if (m_keys > dump_max_entries)
+        summary += fmt::format(", ... ({} more)", m_keys - dump_max_entries);
+    if (m_other != 0)
+        summary += fmt::format(", other ({}x)", m_other);
+
+    log::info("Unknown sequences: {} new, top: {}", m_pending, summary);
+    m_total += m_pending;
+    m_pending = 0;
+    m_other = 0;
+    m_keys = 0;
+    m_counts.fill({});
+}
+
+
+std::string UnknownSeqStats::describe(uint32_t key)
+{
+    const auto kind = Kind(key >> 24);
+    const char f = char((key >> 16) & 0xff);
+    const unsigned param = key & 0xffff;
+    switch (kind) {
+        case Kind::Control:     return fmt::format("C0 {:#04x}", param);
+        case Kind::Escape:      return fmt::format("ESC {}", f);
+        case Kind::Escape_1:    return fmt::format("ESC {} {}", char(param), f);
+        case Kind::CSI:         return fmt::format("CSI {} {}", param, f);
+        case Kind::PrivateCSI:  return fmt::format("CSI {} ... {}", char(param), f);
+        case Kind::InvalidCSI:  return fmt::format("CSI (invalid) {}", f);
+        case Kind::SGR:         return fmt::format("SGR {}", param);
+        case Kind::Mode:        return fmt::format("CSI {} {}", param, f);
+        case Kind::PrivateMode: return fmt::format("CSI ? {} {}", param, f);
+        case Kind::OSC:         return fmt::format("OSC {}", param);
+        case Kind::ControlString: {
+            const char* name = f == 'P' ? "DCS" : f == 'X' ? "SOS" : f == '^' ? "PM" : "APC";
+            return param >= ' ' && param < 127 ? fmt::format("{} {} ...", name, char(param))
+                                               : fmt::format("{} ...", name);
+        }
+    }
+    return "?";
+}
+
+
+} // namespace xci::term
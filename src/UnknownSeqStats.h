@@ -0,0 +1,93 @@
+// UnknownSeqStats.h created on 2026-10-19
+// This file is part of Termic project <https://github.com/rbrich/termic>
+// Copyright 2026 Radek Brich
+// Licensed under the Apache License, Version 2.0 (see LICENSE file)
+
+#ifndef XCITERM_UNKNOWNSEQSTATS_H
+#define XCITERM_UNKNOWNSEQSTATS_H
+
+#include <array>
+#include <string>
+#include <chrono>
+#include <cstdint>
+
+namespace xci::term {
+
+
+/// Histogram of unknown (unsupported) control sequences.
+///
+/// Counting is cheap and doesn't log anything. The summary is logged
+/// by `dump_if_due`, at most once per `dump_interval`, and only
+/// when there were some new unknown sequences since the last dump.
+///
+/// The histogram is a fixed-size hash table, it doesn't allocate.
+/// When `max_keys` distinct sequences were seen since the last dump
+/// (e.g. a program flooding `CSI <n> <f>` with varying n), the others
+/// are counted together as "other".
+class UnknownSeqStats {
+public:
+    using Clock = std::chrono::steady_clock;
+    static constexpr auto dump_interval = std::chrono::seconds(10);
+    static constexpr size_t dump_max_entries = 10;
+    static constexpr size_t max_keys = 256;
+
+    enum class Kind: uint8_t {
+        Control,    // C0 control character, param = the char
+        Escape,     // ESC <f>
+        Escape_1,   // ESC <param> <f>, param = intermediate char
+        CSI,        // CSI <param> ... <f>
+        PrivateCSI, // CSI <param> ... <f>, param = private marker char
+        InvalidCSI, // CSI with unexpected bytes in params
+        SGR,        // CSI <param> m
+        Mode,       // CSI <param> h / l  (SM / RM)
+        PrivateMode,// CSI ? <param> h / l  (DECSET / DECRST)
+        OSC,        // OSC <param> ; ...
+        ControlString, // ESC <f> <param> ... ST (DCS, SOS, PM, APC), param = first char
+    };
+
+    ~UnknownSeqStats() { dump(); }
+
+    void add(Kind kind, char f, unsigned param = 0) {
+        count(uint32_t(kind) << 24 | uint32_t(uint8_t(f)) << 16 | (param & 0xffff));
+        ++m_pending;
+    }
+
+    /// Log the summary if there are new entries and the interval has elapsed.
+    void dump_if_due() {
+        if (m_pending == 0)
+            return;
+        auto now = Clock::now();
+        if (now - m_last_dump < dump_interval)
+            return;
+        m_last_dump = now;
+        dump();
+    }
+
+    /// Log the summary now (if there are new entries)
+    void dump();
+
+    /// Total number of unknown sequences counted
+    uint64_t total() const { return m_total + m_pending; }
+
+    /// Readable description of a histogram key, e.g. "CSI ? 1000 h"
+    static std::string describe(uint32_t key);
+
+private:
+    void count(uint32_t key);
+
+    struct Entry {
+        uint32_t key;
+        unsigned count;  // 0 = empty slot
+    };
+    std::array<Entry, max_keys * 2> m_counts {};  // open addressing, at most half full
+    unsigned m_keys = 0;  // number of used slots
+    unsigned m_other = 0;  // sequences which didn't fit in the table
+    unsigned m_pending = 0;  // number of sequences counted since last dump
+    uint64_t m_total = 0;
+    Clock::time_point m_last_dump {};
+};
+
+
+} // namespace xci::term
+
+#endif // XCITERM_UNKNOWNSEQSTATS_H
@@ -0,0 +1,20 @@
+// debug_log.h created on 2026-10-19
+// This file is part of Termic project <https://github.com/rbrich/termic>
+// Copyright 2026 Radek Brich
+// Licensed under the Apache License, Version 2.0 (see LICENSE file)
+
+#ifndef XCITERM_DEBUG_LOG_H
+#define XCITERM_DEBUG_LOG_H
+
+#include <xci/core/log.h>
+
+// Debug logging for hot paths (decoder, input events).
+// Compiled out unless TERMIC_DEBUG_LOG is defined (CMake option of the same name),
+// the arguments are not evaluated in that case.
+#ifdef TERMIC_DEBUG_LOG
+#define TERMIC_DEBUG(...) ::xci::core::log::debug(__VA_ARGS__)
+#else
+#define TERMIC_DEBUG(...) ((void) 0)
+#endif
+
+#endif // XCITERM_DEBUG_LOG_H
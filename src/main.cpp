@@ -5,18 +5,29 @@
 
 #include "Terminal.h"
 #include "Shell.h"
+#include "MuxServer.h"
+#include "Snapshot.h"
 #include "CircularBuffer.h"
+#include "PerfStats.h"
+#include "Tracer.h"
 #include <xci/widgets/Theme.h>
 #include <xci/widgets/FpsDisplay.h>
+#include <xci/widgets/Label.h>
 #include <xci/graphics/Window.h>
 #include <xci/core/file.h>
 #include <xci/core/log.h>
 #include <xci/core/Vfs.h>
 #include <xci/core/dispatch.h>
 #include <xci/config.h>
+#include <fmt/core.h>
 
+#include <atomic>
 #include <chrono>
+#include <cstdio>
 #include <cstdlib>
+#include <cstring>
+#include <optional>
+#include <string>
 
 using namespace xci::term;
 using namespace xci::widgets;
@@ -24,66 +35,227 @@ using namespace xci::graphics;
 using namespace xci::core;
 using namespace std::chrono_literals;
 
-int main()
+static void print_usage(const char* prog)
+{
+    fmt::print("Usage: {} [--trace FILE] [--low-latency] [--session FILE]\n"
+               "       {} [--server | --attach] [--socket PATH]\n\n"
+               "Options:\n"
+               "  --trace FILE    record timing of the PTY/decode/render pipeline\n"
+               "                  to FILE (Chrome trace-event JSON, open in Perfetto)\n"
+               "  --low-latency   after a keystroke, skip drawing until its echo arrives\n"
+               "  --session FILE  start the shell in the working directory and environment\n"
+               "                  saved in FILE, save them there when the window is closed\n"
+               "  --server        run the shell session without a window, serve it on a socket\n"
+               "  --attach        attach to the session of a running server\n"
+               "  --socket PATH   socket for --server / --attach, its directory must be\n"
+               "                  private (mode 0700) (default: {})\n",
+               prog, prog, mux::default_socket_path());
+}
+
+
+int main(int argc, char* argv[])
 {
     Logger::init();
-    Vfs vfs;
-    if (!vfs.mount(XCI_SHARE_DIR))
+
+    bool low_latency = false;
+    bool server = false;
+    bool attach = false;
+    std::string socket_path;
+    std::string session_path;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--trace") == 0 && i + 1 < argc) {
+            Tracer::start(argv[++i]);
+        } else if (std::strcmp(argv[i], "--low-latency") == 0) {
+            low_latency = true;
+        } else if (std::strcmp(argv[i], "--server") == 0) {
+            server = true;
+        } else if (std::strcmp(argv[i], "--attach") == 0) {
+            attach = true;
+        } else if (std::strcmp(argv[i], "--socket") == 0 && i + 1 < argc) {
+            socket_path = argv[++i];
+        } else if (std::strcmp(argv[i], "--session") == 0 && i + 1 < argc) {
+            session_path = argv[++i];
+        } else if (std::strcmp(argv[i], "-h") == 0 || std::strcmp(argv[i], "--help") == 0) {
+            print_usage(argv[0]);
+            return EXIT_SUCCESS;
+        } else {
+            print_usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+    if (socket_path.empty())
+        socket_path = mux::default_socket_path();
+    if (!session_path.empty() && (server || attach)) {
+        // the session is owned by the server, it outlives the window anyway
+        print_usage(argv[0]);
         return EXIT_FAILURE;
+    }
 
-    Renderer renderer {vfs};
-    Window window {renderer};
-    window.create({800, 600}, "Termic");
+    if (server) {
+        MuxServer mux_server;
+        if (!mux_server.start(socket_path))
+            return EXIT_FAILURE;
+        mux_server.run();
+        return EXIT_SUCCESS;
+    }
 
-    Theme theme(renderer);
-    if (!theme.load_default())
-        return EXIT_FAILURE;
+    Tracer::set_thread_name("main");
+    StartupTimer startup;
 
+    // Start the shell first, so its initialization (rc files, prompt) overlaps
+    // with the renderer, window and theme initialization below. Its output
+    // is buffered in the ring buffer until the first frame decodes it.
+    // The I/O callback doesn't touch the window and terminal until they are
+    // published via these pointers.
     Dispatch dispatch;
     CircularBuffer<640 * 1024> buffer;
     Shell shell;
-    Terminal terminal (theme, shell);
+    std::atomic<Window*> io_window {nullptr};
+    std::atomic<Terminal*> io_terminal {nullptr};
 
-    if (!shell.start())
+    Snapshot session;
+    if (!session_path.empty() && session.load(session_path))
+        log::info("Session: restored from {} (cwd: {})", session_path, session.cwd);
+    if (attach ? !shell.attach(socket_path)
+               : !shell.start(session.cwd, std::move(session.environment)))
         return EXIT_FAILURE;
 
+    // Let the window notice that the shell has closed
+    auto wakeup_window = [&io_window] {
+        if (auto* window = io_window.load(std::memory_order_acquire))
+            window->wakeup();
+    };
+
     IOWatch io_watch(dispatch.loop(), shell.fileno(), IOWatch::Read,
-            [&shell, &buffer, &window](int fd, IOWatch::Event event){
+            [&shell, &buffer, &io_terminal, &wakeup_window](int fd, IOWatch::Event event){
         switch (event) {
             case IOWatch::Event::Read: {
-                auto wb = buffer.acquire_write_buffer();
-                auto nread = shell.read(wb.data(), wb.size());
+                Tracer::set_thread_name("io");
+                std::span<char> wb;
+                {
+                    TERMIC_TRACE_SCOPE("acquire_write_buffer");
+                    wb = buffer.acquire_write_buffer();
+                }
+                ssize_t nread;
+                {
+                    TERMIC_TRACE_SCOPE("pty_read");
+                    nread = shell.read(wb.data(), wb.size());
+                }
                 if (nread > 0) {
                     buffer.bytes_written(size_t(nread));
-                    window.wakeup();
-#ifdef __APPLE__
-                    // MacOS needs this to give the rendering thread some time slots
-                    std::this_thread::sleep_for(50us);
-#else
-                    std::this_thread::yield();
-#endif
+                    auto* terminal = io_terminal.load(std::memory_order_acquire);
+                    if (terminal)
+                        terminal->perf_stats().add_pty_read(size_t(nread));
+                    // Wake the render thread only when it has consumed the previous data,
+                    // not after each read
+                    if (buffer.notify_reader()) {
+                        wakeup_window();
+                        if (terminal)
+                            terminal->perf_stats().add_wakeup();
+                    }
                 } else {
-                    shell.join();
+                    shell.reap();
+                    wakeup_window();
                 }
                 break;
             }
             case IOWatch::Event::Error:
                 shell.stop();
-                shell.join();
+                shell.reap();
+                wakeup_window();
                 break;
             default: break;
         }
     });
 
+    // Shell exit - closes the window even when some background job still holds the PTY open
+    std::optional<IOWatch> exit_watch;
+    if (shell.pidfd() != -1) {
+        exit_watch.emplace(dispatch.loop(), shell.pidfd(), IOWatch::Read,
+                [&shell, &wakeup_window](int fd, IOWatch::Event event) {
+            if (shell.reap())
+                wakeup_window();
+        });
+    }
+    startup.phase("shell");
+
+    // From here on, the I/O thread runs callbacks which reference the locals above.
+    // Stop it before leaving main, before they are destroyed.
+    Vfs vfs;
+    if (!vfs.mount(XCI_SHARE_DIR)) {
+        dispatch.terminate();
+        return EXIT_FAILURE;
+    }
+    startup.phase("vfs");
+
+    Renderer renderer {vfs};
+    Window window {renderer};
+    window.create({800, 600}, "Termic");
+    startup.phase("window");
+
+    // Fonts are uploaded to GPU textures, which need the device created by the window
+    Theme theme(renderer);
+    if (!theme.load_default()) {
+        dispatch.terminate();
+        return EXIT_FAILURE;
+    }
+    startup.phase("theme");
+
+    Terminal terminal (theme, shell);
+    terminal.set_low_latency(low_latency);
+    io_terminal.store(&terminal, std::memory_order_release);
+    io_window.store(&window, std::memory_order_release);
+
     FpsDisplay fps_display {theme};
 
+    // Performance overlay (toggle with Shift+F10)
+    Label perf_display {theme};
+    bool perf_display_enabled = false;
+    std::chrono::steady_clock::time_point perf_display_updated;
+
+    bool startup_reported = false;
+
     window.set_update_callback(
-        [&terminal, &buffer, &shell]
+        [&terminal, &buffer, &shell, &perf_display, &perf_display_enabled, &perf_display_updated,
+         &startup, &startup_reported]
         (View& v, std::chrono::nanoseconds elapsed) {
-            auto rb = buffer.read_buffer();
-            if (!rb.empty()) {
-                terminal.decode_input(rb);
-                buffer.bytes_read(rb.size());
+            TERMIC_TRACE_SCOPE("update");
+            auto& stats = terminal.perf_stats();
+            buffer.rearm_reader();
+            terminal.update_winsize(v);
+            terminal.send_mouse_reports(v);
+            if (auto pending = buffer.read_size(); pending != 0) {
+                auto buffer_fill = double(pending) / double(buffer.capacity());
+                // Fast-forward: when the backlog is many screens deep, the intermediate
+                // screens would never be seen. Keep decoding until the buffer is drained
+                // (or the time budget is exhausted) and draw only the final screen.
+                const bool fast_forward = pending > terminal.fast_forward_threshold();
+                auto decode_start = std::chrono::steady_clock::now();
+                auto decode_end = decode_start;
+                do {
+                    auto rb = buffer.read_buffer();
+                    if (rb.empty())
+                        break;
+                    terminal.decode_input(rb);
+                    buffer.bytes_read(rb.size());
+                    decode_end = std::chrono::steady_clock::now();
+                } while (fast_forward && decode_end - decode_start < Terminal::fast_forward_budget);
+                stats.add_frame(decode_end - decode_start, buffer_fill, terminal.decode_counters());
+                v.refresh();
+                // The rest (if any) won't wake us again, schedule next update
+                if (buffer.read_size() != 0)
+                    v.window()->wakeup();
+                if (!startup_reported) {
+                    startup_reported = true;
+                    startup.phase("first output");
+                    log::info("Startup phases:\n{}", startup.format());
+                }
+            }
+            auto now = std::chrono::steady_clock::now();
+            stats.update(now);
+            if (perf_display_enabled && now - perf_display_updated >= 500ms) {
+                perf_display_updated = now;
+                perf_display.text().set_string(stats.format());
                 v.refresh();
             }
             if (shell.is_closed()) {
@@ -92,28 +264,54 @@ int main()
         });
 
     // Make the terminal fullscreen
-    window.set_size_callback([&terminal, &fps_display](View& view) {
+    window.set_size_callback([&terminal, &fps_display, &perf_display](View& view) {
         auto s = view.viewport_size();
         terminal.set_size(s);
         fps_display.set_position({s.x - 120, 20});
         fps_display.set_size({100, 20});
+        perf_display.set_position({s.x - 420, 50});
+        perf_display.set_size({400, 220});
     });
 
     Composite root(theme);
     root.add(terminal);
     root.add(fps_display);
+    root.add(perf_display);
     root.set_focus(terminal);
 
     window.set_key_callback([&](View& view, KeyEvent ev) {
         if (ev.action == Action::Press && ev.mod == ModKey::Shift() && ev.key == Key::F11)
             window.toggle_fullscreen();
+        if (ev.action == Action::Press && ev.mod == ModKey::Shift() && ev.key == Key::F10) {
+            perf_display_enabled = !perf_display_enabled;
+            perf_display_updated = {};
+            if (!perf_display_enabled)
+                perf_display.text().set_string("");
+            view.refresh();
+        }
     });
 
     Bind bind(window, root);
     window.set_refresh_mode(RefreshMode::OnDemand);
     window.set_view_mode(ViewOrigin::TopLeft, ViewScale::FixedScreenPixels);
+    startup.phase("terminal");
     window.display();
 
+    // The waiter would wake the window which is about to be destroyed
+    shell.cancel_notify_writable();
+
+    // Save the session for the next start, unless the shell has ended it
+    if (!session_path.empty()) {
+        if (shell.is_closed())
+            std::remove(session_path.c_str());
+        else
+            Snapshot{shell.cwd(), shell.environment()}.save(session_path);
+    }
+
+    log::info("Terminal performance stats:\n{}", terminal.perf_stats().format());
+    log::info("Keystroke-to-photon latency:\n{}", terminal.perf_stats().format_latency_histogram());
+    // The watches are destroyed before the shell, which then closes the watched fds
     dispatch.terminate();
+    Tracer::stop();
     return EXIT_SUCCESS;
 }
@@ -0,0 +1,81 @@
+// unicode.cpp created on 2026-10-19
+// This file is part of Termic project <https://github.com/rbrich/termic>
+// Copyright 2026 Radek Brich
+// Licensed under the Apache License, Version 2.0 (see LICENSE file)
+
+#include "unicode.h"
+#include <cstring>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace xci::term {
+
+
+size_t ascii_prefix(std::string_view sv)
+{
+    const char* p = sv.data();
+    const char* end = p + sv.size();
+#ifdef __SSE2__
+    for (; end - p >= 16; p += 16) {
+        const auto v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        if (const int mask = _mm_movemask_epi8(v); mask != 0)
+            return size_t(p - sv.data()) + unsigned(__builtin_ctz(unsigned(mask)));
+    }
+#endif
+    for (; end - p >= 8; p += 8) {
+        uint64_t w;
+        std::memcpy(&w, p, 8);
+        if ((w & 0x8080808080808080u) != 0)
+            break;
+    }
+    while (p != end && (uint8_t(*p) & 0x80) == 0)
+        ++p;
+    return size_t(p - sv.data());
+}
+
+
+size_t utf8_decode(std::string_view sv, char32_t& cp)
+{
+    const auto b0 = uint8_t(sv[0]);
+    if (b0 < 0x80) {
+        cp = b0;
+        return 1;
+    }
+    // number of continuation bytes and the allowed range of the first one
+    // (excludes overlong forms, surrogates and > U+10FFFF)
+    size_t n;
+    uint8_t lo = 0x80, hi = 0xBF;
+    if (b0 >= 0xC2 && b0 <= 0xDF) {
+        n = 1; cp = b0 & 0x1F;
+    } else if (b0 >= 0xE0 && b0 <= 0xEF) {
+        n = 2; cp = b0 & 0x0F;
+        if (b0 == 0xE0) lo = 0xA0;
+        if (b0 == 0xED) hi = 0x9F;
+    } else if (b0 >= 0xF0 && b0 <= 0xF4) {
+        n = 3; cp = b0 & 0x07;
+        if (b0 == 0xF0) lo = 0x90;
+        if (b0 == 0xF4) hi = 0x8F;
+    } else {
+        cp = utf8_invalid;
+        return 1;
+    }
+    for (size_t i = 1; i <= n; ++i) {
+        if (i == sv.size()) {
+            cp = utf8_invalid;
+            return i;
+        }
+        const auto b = uint8_t(sv[i]);
+        if (b < lo || b > hi) {
+            cp = utf8_invalid;
+            return i;
+        }
+        cp = (cp << 6) | (b & 0x3F);
+        lo = 0x80; hi = 0xBF;
+    }
+    return n + 1;
+}
+
+
+} // namespace xci::term
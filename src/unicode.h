@@ -0,0 +1,49 @@
+// unicode.h created on 2026-10-19
+// This file is part of Termic project <https://github.com/rbrich/termic>
+// Copyright 2026 Radek Brich
+// Licensed under the Apache License, Version 2.0 (see LICENSE file)
+
+#ifndef XCITERM_UNICODE_H
+#define XCITERM_UNICODE_H
+
+#include "char_width_table.h"
+#include <string_view>
+#include <cstdint>
+#include <cstddef>
+
+namespace xci::term {
+
+
+/// Length of the leading run of ASCII characters in `sv`.
+/// Checks 16 bytes at once (SSE2) or 8 bytes (portable).
+size_t ascii_prefix(std::string_view sv);
+
+/// Code point returned by utf8_decode for invalid input
+inline constexpr char32_t utf8_invalid = ~char32_t(0);
+
+/// Decode one UTF-8 character from the beginning of `sv` (must not be empty).
+/// Overlong forms, surrogates and code points above U+10FFFF are invalid,
+/// as are truncated sequences.
+/// \param cp   decoded code point or `utf8_invalid`
+/// \returns    length of the character, or of the maximal invalid subpart
+///             (each should be replaced by single U+FFFD, as per Unicode 3.9)
+size_t utf8_decode(std::string_view sv, char32_t& cp);
+
+/// Number of terminal cells taken by the character:
+/// 0 - combining marks, format and control characters
+/// 1 - narrow (most characters)
+/// 2 - East Asian Wide and Fullwidth (CJK, emoji)
+constexpr unsigned char_width(char32_t cp)
+{
+    using namespace char_width_table;
+    if (cp >= 0x110000)
+        return 1;
+    const auto block = stage1[cp >> 8];
+    const auto i = cp & 0xFF;
+    return (stage2[block][i >> 2] >> (2 * (i & 3))) & 3;
+}
+
+
+} // namespace xci::term
+
+#endif // XCITERM_UNICODE_H
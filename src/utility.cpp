@@ -4,46 +4,108 @@
 // Licensed under the Apache License, Version 2.0 (see LICENSE file)
 
 #include "utility.h"
-#include <xci/core/log.h>
-#include <cstdlib>
+#include "debug_log.h"
+#include <algorithm>
 
 namespace xci::term {
 
 using namespace xci::core;
 
 
-bool cseq_next_param(std::string_view& params, unsigned& p)
+void CseqParams::feed(char c)
 {
-    bool p_touched = false;
-    while (!params.empty()) {
-        char c = params[0];
-        if (isdigit(c)) {
-            if (!p_touched) {
-                p = 0;
-                p_touched = true;
+    if (c >= '0' && c <= '9') {
+        if (m_num_values == 0 && !add_value(true))
+            return;
+        if (m_overflow)
+            return;  // dropping excess params
+        auto& v = m_values[m_num_values - 1];
+        if (v == c_empty)
+            v = 0;
+        v = std::min(v * 10 + unsigned(c - '0'), max_value);
+        return;
+    }
+    switch (c) {
+        case ';':
+            if (m_num_values == 0)
+                add_value(true);  // first param is empty
+            add_value(true);
+            return;
+        case ':':
+            if (m_num_values == 0)
+                add_value(true);
+            add_value(false);
+            return;
+        case '<':
+        case '=':
+        case '>':
+        case '?':
+            if (m_num_values == 0 && m_marker == 0) {
+                m_marker = c;
+                return;
             }
-            p = p * 10 + (c - '0');
-        } else if (c == ';') {
-            params.remove_prefix(1);
-            return true;
-        }
-        params.remove_prefix(1);
+            [[fallthrough]];
+        default:
+            m_invalid = true;
+            return;
+    }
+}
+
+
+bool CseqParams::add_value(bool new_param)
+{
+    if (m_overflow || m_num_values == max_values || (new_param && m_num_params == max_params)) {
+        m_overflow = true;
+        return false;
+    }
+    if (new_param)
+        m_start[m_num_params++] = m_num_values;
+    m_values[m_num_values++] = c_empty;
+    return true;
+}
+
+
+size_t encode_utf8(char32_t cp, char out[4])
+{
+    if (cp < 0x80) {
+        out[0] = char(cp);
+        return 1;
+    }
+    if (cp < 0x800) {
+        out[0] = char(0xC0 | (cp >> 6));
+        out[1] = char(0x80 | (cp & 0x3F));
+        return 2;
+    }
+    if ((cp >= 0xD800 && cp <= 0xDFFF) || cp > 0x10FFFF)
+        cp = 0xFFFD;  // replacement character
+    if (cp < 0x10000) {
+        out[0] = char(0xE0 | (cp >> 12));
+        out[1] = char(0x80 | ((cp >> 6) & 0x3F));
+        out[2] = char(0x80 | (cp & 0x3F));
+        return 3;
     }
-    return false;
+    out[0] = char(0xF0 | (cp >> 18));
+    out[1] = char(0x80 | ((cp >> 12) & 0x3F));
+    out[2] = char(0x80 | ((cp >> 6) & 0x3F));
+    out[3] = char(0x80 | (cp & 0x3F));
+    return 4;
 }
 
 
-void cseq_parse_params(const char *name, std::string_view &params, unsigned& p1)
+void cseq_parse_params([[maybe_unused]] const char *name, const CseqParams& params, unsigned& p1)
 {
-    if (cseq_next_param(params, p1))
-        log::warning("Excess params for {} ignored: {}", name, params);
+    p1 = params.get(0, p1);
+    if (params.size() > 1)
+        TERMIC_DEBUG("Excess params for {} ignored: {}", name, params);
 }
 
 
-void cseq_parse_params(const char *name, std::string_view &params, unsigned& p1, unsigned& p2)
+void cseq_parse_params([[maybe_unused]] const char *name, const CseqParams& params, unsigned& p1, unsigned& p2)
 {
-    if (cseq_next_param(params, p1) && cseq_next_param(params, p2))
-        log::warning("Excess params for {} ignored: {}", name, params);
+    p1 = params.get(0, p1);
+    p2 = params.get(1, p2);
+    if (params.size() > 2)
+        TERMIC_DEBUG("Excess params for {} ignored: {}", name, params);
 }
 
 
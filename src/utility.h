@@ -7,22 +7,151 @@
 #define XCITERM_UTILITY_H
 
 #include <string_view>
+#include <algorithm>
+#include <cstring>
+#include <cstdint>
+#include <fmt/format.h>
 
 namespace xci::term {
 
-/// Parses parameter string of control sequence
-/// according to ECMA-48 standard.
-/// \param[in,out]  params  A string view with the params.
-///                         The parsed prefix will be removed.
-/// \param[out]     p       The parsed parameter will be put here.
-///                         If no digits were parsed, the content won't be modified.
-/// \return         True if there are more parameters to be parsed.
-///                 False if this was the last one.
-bool cseq_next_param(std::string_view& params, unsigned& p);
+/// Parameters of control sequence (ECMA-48), parsed in single pass
+/// while the sequence bytes are being received.
+///
+/// Each parameter has a value and optional sub-parameters
+/// (colon-separated, ITU T.416), e.g. "38:2::10:20:30" or "4:3".
+/// The storage has fixed capacity, excess parameters are dropped
+/// and the overflow is flagged. Values are clamped to `max_value`.
+class CseqParams {
+public:
+    static constexpr unsigned max_params = 16;  // parameters
+    static constexpr unsigned max_values = 32;  // parameters + sub-parameters
+    static constexpr unsigned max_value = 65535;
 
-void cseq_parse_params(const char* name, std::string_view& params, unsigned& p1);
-void cseq_parse_params(const char* name, std::string_view& params, unsigned& p1, unsigned& p2);
+    /// Reset state for next sequence.
+    void clear() { m_num_params = 0; m_num_values = 0; m_marker = 0; m_overflow = false; m_invalid = false; }
+
+    /// Parse next parameter byte (0x30 .. 0x3F)
+    void feed(char c);
+
+    /// Parse whole parameter string (convenience, e.g. for tests)
+    void parse(std::string_view params) { clear(); for (char c : params) feed(c); }
+
+    /// Number of parameters (excluding sub-parameters)
+    unsigned size() const { return m_num_params; }
+    bool empty() const { return m_num_params == 0; }
+
+    /// Get value of i-th parameter. Returns `dfl` if the parameter is missing or empty.
+    unsigned get(unsigned i, unsigned dfl) const {
+        return i < m_num_params ? value_or(m_start[i], dfl) : dfl;
+    }
+
+    /// Number of sub-parameters of i-th parameter
+    unsigned num_sub(unsigned i) const {
+        return i < m_num_params ? end(i) - m_start[i] - 1 : 0;
+    }
+
+    /// Get j-th sub-parameter of i-th parameter (j counts from 0).
+    /// Returns `dfl` if the sub-parameter is missing or empty.
+    unsigned sub(unsigned i, unsigned j, unsigned dfl) const {
+        return j < num_sub(i) ? value_or(m_start[i] + 1 + j, dfl) : dfl;
+    }
+
+    /// Private parameter marker ('<', '=', '>', '?') or zero if not present
+    char marker() const { return m_marker; }
+
+    /// Some parameters were dropped due to capacity
+    bool overflow() const { return m_overflow; }
+
+    /// Unexpected byte in parameter string (the sequence should be ignored)
+    bool invalid() const { return m_invalid; }
+
+private:
+    static constexpr unsigned c_empty = ~0u;
+
+    unsigned value_or(unsigned idx, unsigned dfl) const {
+        return m_values[idx] == c_empty ? dfl : m_values[idx];
+    }
+    unsigned end(unsigned i) const {
+        return i + 1 < m_num_params ? m_start[i + 1] : m_num_values;
+    }
+    bool add_value(bool new_param);
+
+    unsigned m_values[max_values];
+    uint8_t m_start[max_params];  // index of first value for each param
+    uint8_t m_num_params = 0;
+    uint8_t m_num_values = 0;
+    char m_marker = 0;
+    bool m_overflow = false;
+    bool m_invalid = false;
+};
+
+/// Get first parameter, warn if there are excess parameters.
+void cseq_parse_params(const char* name, const CseqParams& params, unsigned& p1);
+/// Get first two parameters, warn if there are excess parameters.
+void cseq_parse_params(const char* name, const CseqParams& params, unsigned& p1, unsigned& p2);
+
+/// Encode Unicode code point to UTF-8, without allocation.
+/// Invalid code points (surrogates, > 0x10FFFF) are encoded as U+FFFD.
+/// \returns   number of bytes written to `out` (1 to 4)
+size_t encode_utf8(char32_t cp, char out[4]);
+
+/// Produce `num` copies of UTF-8 character `ch` without heap allocation.
+/// The copies are written to a fixed-size stack buffer and passed
+/// to the callback in chunks.
+/// \param ch      Single UTF-8 encoded character, possibly with combining marks
+///                 or the padding of a wide char (1 to `max_repeat_char` bytes).
+/// \param num     Total number of copies to produce.
+/// \param fn      Called as `fn(std::string_view chunk, unsigned chars)`
+///                 for each chunk, `chars` is the number of copies in the chunk.
+constexpr size_t max_repeat_char = 16;
+
+template <class F>
+void repeat_char(std::string_view ch, unsigned num, F&& fn)
+{
+    constexpr size_t chunk_size = 256;
+    if (ch.empty() || ch.size() > max_repeat_char || num == 0)
+        return;
+    char buffer[chunk_size];
+    const unsigned chunk_chars = chunk_size / ch.size();
+    const unsigned fill_chars = std::min(num, chunk_chars);
+    for (unsigned i = 0; i != fill_chars; ++i)
+        std::memcpy(buffer + i * ch.size(), ch.data(), ch.size());
+    while (num != 0) {
+        const unsigned n = std::min(num, chunk_chars);
+        fn(std::string_view(buffer, n * ch.size()), n);
+        num -= n;
+    }
+}
 
 } // namespace xci::term
 
+
+// Format the params back to their textual form (for logging)
+template <>
+struct fmt::formatter<xci::term::CseqParams> {
+    constexpr auto parse(format_parse_context& ctx) { return ctx.begin(); }
+
+    template <typename FormatContext>
+    auto format(const xci::term::CseqParams& params, FormatContext& ctx) const {
+        auto out = ctx.out();
+        if (params.marker())
+            *out++ = params.marker();
+        constexpr unsigned empty = ~0u;
+        for (unsigned i = 0; i != params.size(); ++i) {
+            if (i != 0)
+                *out++ = ';';
+            auto p = params.get(i, empty);
+            if (p != empty)
+                out = fmt::format_to(out, "{}", p);
+            for (unsigned j = 0; j != params.num_sub(i); ++j) {
+                *out++ = ':';
+                auto sp = params.sub(i, j, empty);
+                if (sp != empty)
+                    out = fmt::format_to(out, "{}", sp);
+            }
+        }
+        return out;
+    }
+};
+
 #endif // XCITERM_UTILITY_H
@@ -0,0 +1,109 @@
+// test_alloc.cpp created on 2026-10-19
+// This file is part of Termic project <https://github.com/rbrich/termic>
+// Copyright 2026 Radek Brich
+// Licensed under the Apache License, Version 2.0 (see LICENSE file)
+
+// Check that the decoder doesn't allocate in steady state.
+// The global operator new is replaced to count the allocations.
+// Terminal writes into the real TextTerminal, without a window. The corpus
+// stays within the page, so the buffer doesn't grow by new lines.
+
+#define CATCH_CONFIG_MAIN
+#include <catch2/catch.hpp>
+#include "Terminal.h"
+#include "utility.h"
+#include "UnknownSeqStats.h"
+#include <xci/widgets/Theme.h>
+#include <xci/graphics/Renderer.h>
+#include <xci/core/Vfs.h>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <string>
+
+using namespace xci::term;
+using std::string_view;
+
+
+static std::atomic<size_t> g_alloc_count {0};
+
+// noinline: otherwise GCC warns about free() of pointer from operator new
+[[gnu::noinline]] void* operator new(size_t size)
+{
+    g_alloc_count.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size ? size : 1))
+        return p;
+    throw std::bad_alloc();
+}
+[[gnu::noinline]] void operator delete(void* p) noexcept { std::free(p); }
+[[gnu::noinline]] void operator delete(void* p, size_t) noexcept { std::free(p); }
+
+
+// Typical output of full-screen programs, colored logs and shell prompts
+static constexpr string_view c_corpus =
+        "\033[H\033[?1049h\033[22;0;0t\033[1;24r\033(B\033[m\033[4l\033[?7h\033[H\033[2J"
+        "\033[1;1H\033[30;47m  htop 3.0 \033[39;49m\033[K\033[2;3H\033[1m\033[36mCPU\033[m"
+        "\033[38;5;244m[\033[38;2;0;255;0m|||||\033[38:2::255:0:0m||\033[m 12.5%\033[38;5;244m]"
+        "\033[4:3mcurly\033[4:0m \033[7X\033[3b\033[?25l\033[?12;25h\033[10;20f\033[0J\033[1K"
+        "\033[?1049l\033]0;user@host: ~/src\007\033]8;;https://example.com\033\\link\033]8;;\033\\"
+        "\033]52;c;dGVybWlj\007\033P1;2q#0;2;0;0;0#0!10~\033\\\033[?2026h\033[99z\033%G"
+        "\033[31;1m2021-10-19 error:\033[0m\tsomething failed \xe2\x94\x80\xe2\x94\x80"
+        "\xe6\xbc\xa2\xe5\xad\x97 \xcc\x81\xff\r\n";
+
+
+// Decode the corpus, split in chunks, so the sequences and UTF-8 chars
+// are also interrupted between calls
+static void decode_corpus(Terminal& terminal)
+{
+    for (size_t pos = 0; pos < c_corpus.size(); pos += 37)
+        terminal.decode_input(c_corpus.substr(pos, 37));
+}
+
+
+TEST_CASE( "decode corpus without allocation", "[alloc]" )
+{
+    xci::core::Vfs vfs;
+    xci::graphics::Renderer renderer {vfs};
+    xci::widgets::Theme theme {renderer};
+    Shell shell;
+    Terminal terminal(theme, shell);
+
+    // warm-up: the buffers grow to their working size
+    decode_corpus(terminal);
+
+    auto before = g_alloc_count.load();
+    for (int i = 0; i != 100; ++i)
+        decode_corpus(terminal);
+    auto allocs = g_alloc_count.load() - before;
+
+    CHECK(allocs == 0);
+    CHECK(terminal.title() == "user@host: ~/src");
+}
+
+
+TEST_CASE( "unknown sequence flood without allocation", "[alloc]" )
+{
+    UnknownSeqStats stats;
+    auto before = g_alloc_count.load();
+    for (unsigned n = 0; n != 100000; ++n)
+        stats.add(UnknownSeqStats::Kind::CSI, 'y', n);
+    auto allocs = g_alloc_count.load() - before;
+
+    CHECK(allocs == 0);
+    CHECK(stats.total() == 100000);
+}
+
+
+TEST_CASE( "keystroke encoding without allocation", "[alloc]" )
+{
+    char utf8[4];
+    size_t total = 0;
+
+    auto before = g_alloc_count.load();
+    for (char32_t cp : {U'a', U'é', U'─', U'\U0001F600'})
+        total += encode_utf8(cp, utf8);
+    auto allocs = g_alloc_count.load() - before;
+
+    CHECK(allocs == 0);
+    CHECK(total == 1 + 2 + 3 + 4);
+}
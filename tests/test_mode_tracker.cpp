@@ -0,0 +1,53 @@
+// test_mode_tracker.cpp created on 2026-10-19
+// This file is part of Termic project <https://github.com/rbrich/termic>
+// Copyright 2026 Radek Brich
+// Licensed under the Apache License, Version 2.0 (see LICENSE file)
+
+#define CATCH_CONFIG_MAIN
+#include <catch2/catch.hpp>
+#include "ModeTracker.h"
+#include <string>
+
+using namespace xci::term;
+
+
+static std::string encode(const ModeTracker& tracker)
+{
+    std::string out;
+    tracker.encode(out);
+    return out;
+}
+
+
+TEST_CASE( "ModeTracker/modes", "[mode_tracker]" )
+{
+    ModeTracker tracker;
+    CHECK(encode(tracker).empty());
+
+    // vim: alternate screen, cursor keys, mouse tracking - split in middle of sequences
+    tracker.feed("$ vim\r\n\033[?1049h\033[?1h\033=\033[?10");
+    tracker.feed("02h\033[?1006h\033[?2004htext");
+    CHECK(encode(tracker) == "\033[?1049h\033[?1h\033[?1002h\033[?1006h\033[?2004h");
+
+    // OSC payload is skipped
+    tracker.feed("\033]0;vim [?1l\a\033]2;x\033\\");
+    CHECK(encode(tracker) == "\033[?1049h\033[?1h\033[?1002h\033[?1006h\033[?2004h");
+
+    // any of the mouse modes turns the tracking off
+    tracker.feed("\033[?1000;1006l\033[?1049;1;2004l\033[?7l\033[4h");
+    CHECK(encode(tracker) == "\033[?7l\033[4h");
+}
+
+
+TEST_CASE( "ModeTracker/attributes", "[mode_tracker]" )
+{
+    ModeTracker tracker;
+    tracker.feed("\033[1;31mred\033[0m");
+    CHECK(encode(tracker).empty());
+
+    tracker.feed("\033[1;4:3;38;5;100m\033[48:2::1:2:3m\033[22m");
+    CHECK(encode(tracker) == "\033[0;4:3;38;5;100;48;2;1;2;3m");
+
+    tracker.feed("\033[m\033[4;97;41m");
+    CHECK(encode(tracker) == "\033[0;4;97;41m");
+}
@@ -0,0 +1,91 @@
+// test_mouse_reporter.cpp created on 2026-10-19
+// This file is part of Termic project <https://github.com/rbrich/termic>
+// Copyright 2026 Radek Brich
+// Licensed under the Apache License, Version 2.0 (see LICENSE file)
+
+#define CATCH_CONFIG_MAIN
+#include <catch2/catch.hpp>
+#include "MouseReporter.h"
+#include <string>
+
+using namespace xci::term;
+using Tracking = MouseReporter::Tracking;
+using Button = MouseReporter::Button;
+
+
+static std::string take(MouseReporter& mouse)
+{
+    std::string out {mouse.pending()};
+    mouse.clear();
+    return out;
+}
+
+
+TEST_CASE( "MouseReporter/buttons", "[mouse]" )
+{
+    MouseReporter mouse;
+    mouse.button(Button::Left, true, {0, 0});
+    CHECK(take(mouse).empty());  // tracking is off
+
+    mouse.set_tracking(Tracking::Buttons);
+    mouse.button(Button::Left, true, {0, 0});
+    mouse.motion({5, 5});  // not tracked
+    mouse.button(Button::Left, false, {5, 5});
+    CHECK(take(mouse) == "\033[M !!\033[M#&&");
+
+    mouse.set_sgr(true);
+    mouse.button(Button::Right, true, {299, 9});
+    mouse.button(Button::Right, false, {299, 9});
+    mouse.button(Button::WheelDown, true, {1, 2});
+    mouse.button(Button::WheelDown, false, {1, 2});
+    CHECK(take(mouse) == "\033[<2;300;10M\033[<2;300;10m\033[<65;2;3M");
+
+    // released without press (e.g. the press enabled the tracking)
+    mouse.button(Button::Middle, false, {0, 0});
+    CHECK(take(mouse).empty());
+}
+
+
+TEST_CASE( "MouseReporter/motion coalescing", "[mouse]" )
+{
+    MouseReporter mouse;
+    mouse.set_sgr(true);
+
+    mouse.set_tracking(Tracking::Drag);
+    mouse.motion({1, 1});
+    CHECK(take(mouse).empty());  // no button held
+    mouse.button(Button::Left, true, {1, 1});
+    for (int x = 2; x != 50; ++x)
+        mouse.motion({x, 1});
+    CHECK(take(mouse) == "\033[<0;2;2M\033[<32;50;2M");
+    // back and forth within a frame, ending in the reported cell
+    mouse.motion({10, 1});
+    mouse.motion({49, 1});
+    CHECK(take(mouse).empty());
+    // the release carries the position, the motion before is dropped
+    mouse.motion({20, 3});
+    mouse.button(Button::Left, false, {21, 3});
+    CHECK(take(mouse) == "\033[<0;22;4m");
+
+    mouse.set_tracking(Tracking::Motion);
+    mouse.motion({3, 4});
+    mouse.motion({7, 8});
+    CHECK(take(mouse) == "\033[<35;8;9M");
+}
+
+
+TEST_CASE( "MouseReporter/application not reading", "[mouse]" )
+{
+    MouseReporter mouse;
+    mouse.set_tracking(Tracking::Buttons);
+    mouse.button(Button::Right, true, {0, 0});
+    for (int i = 0; i != 10000; ++i)
+        mouse.button(Button::WheelUp, true, {0, 0});
+    mouse.button(Button::Left, true, {0, 0});  // dropped
+    const auto size = mouse.pending().size();
+    CHECK(size < MouseReporter::max_pending + 32);  // at most one report over
+    // the held button is released, the dropped one isn't
+    mouse.button(Button::Right, false, {0, 0});
+    mouse.button(Button::Left, false, {0, 0});
+    CHECK(mouse.pending().substr(size) == "\033[M#!!");
+}
@@ -0,0 +1,105 @@
+// test_osc.cpp created on 2026-10-19
+// This file is part of Termic project <https://github.com/rbrich/termic>
+// Copyright 2026 Radek Brich
+// Licensed under the Apache License, Version 2.0 (see LICENSE file)
+
+#define CATCH_CONFIG_MAIN
+#include <catch2/catch.hpp>
+#include "OscParser.h"
+#include <string>
+
+using std::string_view;
+using namespace xci::term;
+using Cmd = OscParser::Command;
+
+
+static void parse(OscParser& osc, string_view s)
+{
+    osc.clear();
+    for (char c : s)
+        osc.feed(c);
+}
+
+
+TEST_CASE( "OscParser/title", "[osc]" )
+{
+    OscParser osc;
+    parse(osc, "0;hello ☺");
+    CHECK(osc.command() == Cmd::Title);
+    CHECK(osc.payload() == "hello ☺");
+
+    parse(osc, "2;");
+    CHECK(osc.command() == Cmd::Title);
+    CHECK(osc.payload().empty());
+
+    parse(osc, "104");
+    CHECK(osc.command() == Cmd::None);
+    parse(osc, "777;notify;x");
+    CHECK(osc.command() == Cmd::Unknown);
+    CHECK(osc.number() == 777);
+    CHECK(osc.payload().empty());
+}
+
+
+TEST_CASE( "OscParser/bounded", "[osc]" )
+{
+    OscParser osc;
+    parse(osc, "2;" + std::string(OscParser::max_title, 'x'));
+    CHECK(!osc.overflow());
+    CHECK(osc.payload().size() == OscParser::max_title);
+
+    osc.clear();
+    for (char c : string_view("2;"))
+        osc.feed(c);
+    for (size_t i = 0; i != 10 * 1024 * 1024; ++i)
+        osc.feed('x');
+    CHECK(osc.overflow());
+    CHECK(osc.payload().empty());
+
+    // unknown commands don't store anything
+    parse(osc, "1337;File=" + std::string(100000, 'A'));
+    CHECK(osc.command() == Cmd::Unknown);
+    CHECK(osc.payload().empty());
+}
+
+
+TEST_CASE( "OscParser/hyperlink", "[osc]" )
+{
+    OscParser osc;
+    parse(osc, "8;id=abc:x=1;https://example.com/a;b");
+    CHECK(osc.command() == Cmd::Hyperlink);
+    CHECK(osc.hyperlink_uri() == "https://example.com/a;b");
+
+    parse(osc, "8;;https://example.com");
+    CHECK(osc.hyperlink_uri() == "https://example.com");
+
+    parse(osc, "8;;");
+    CHECK(osc.hyperlink_uri().empty());
+}
+
+
+TEST_CASE( "OscParser/clipboard", "[osc]" )
+{
+    OscParser osc;
+    parse(osc, "52;c;SGVsbG8sIHdvcmxkIQ==");
+    CHECK(osc.command() == Cmd::Clipboard);
+    CHECK(!osc.invalid());
+    CHECK(osc.payload() == "Hello, world!");
+
+    parse(osc, "52;;YWJj");
+    CHECK(osc.payload() == "abc");
+    parse(osc, "52;p;YWI=");
+    CHECK(osc.payload() == "ab");
+
+    parse(osc, "52;c;?");
+    CHECK(osc.clipboard_query());
+
+    parse(osc, "52;c;YW*j");
+    CHECK(osc.invalid());
+    parse(osc, "52;c;YQ==YQ==");
+    CHECK(osc.invalid());
+
+    parse(osc, "52;c;" + std::string(OscParser::max_clipboard / 3 * 4 + 8, 'A'));
+    CHECK(osc.overflow());
+    CHECK(osc.payload().empty());
+}
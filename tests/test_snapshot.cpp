@@ -0,0 +1,94 @@
+// test_snapshot.cpp created on 2026-10-19
+// This file is part of Termic project <https://github.com/rbrich/termic>
+// Copyright 2026 Radek Brich
+// Licensed under the Apache License, Version 2.0 (see LICENSE file)
+
+#define CATCH_CONFIG_MAIN
+#include <catch2/catch.hpp>
+#include "Snapshot.h"
+#include <cstdio>
+#include <string>
+
+using namespace xci::term;
+
+
+TEST_CASE( "Snapshot/encode", "[snapshot]" )
+{
+    Snapshot snapshot {"/home/user/src", {"HOME=/home/user", "EMPTY=", "LANG=cs_CZ.UTF-8"}};
+    std::string data;
+    snapshot.encode(data);
+    CHECK(data.substr(0, 8) == std::string("TMSN\x01\0\0\0", 8));
+
+    Snapshot decoded {"/tmp", {"X=1"}};
+    REQUIRE(decoded.decode(data));
+    CHECK(decoded.cwd == snapshot.cwd);
+    CHECK(decoded.environment == snapshot.environment);
+
+    // empty snapshot
+    data.clear();
+    Snapshot{}.encode(data);
+    CHECK(data.size() == 16);
+    REQUIRE(decoded.decode(data));
+    CHECK(decoded.cwd.empty());
+    CHECK(decoded.environment.empty());
+}
+
+
+TEST_CASE( "Snapshot/malformed", "[snapshot]" )
+{
+    std::string data;
+    Snapshot{"/home/user", {"A=1", "B=2"}}.encode(data);
+    Snapshot decoded;
+
+    // truncated anywhere
+    for (size_t size = 0; size != data.size(); ++size)
+        CHECK_FALSE(decoded.decode(std::string_view(data).substr(0, size)));
+
+    // trailing garbage
+    CHECK_FALSE(decoded.decode(data + "x"));
+
+    // other version
+    auto other = data;
+    other[4] = 2;
+    CHECK_FALSE(decoded.decode(other));
+
+    // bad magic
+    other = data;
+    other[0] = 'X';
+    CHECK_FALSE(decoded.decode(other));
+
+    // huge count of variables
+    other = data;
+    other.replace(22, 4, "\xff\xff\xff\xff");
+    CHECK_FALSE(decoded.decode(other));
+}
+
+
+TEST_CASE( "Snapshot/file", "[snapshot]" )
+{
+    const std::string path = "test_snapshot.tmp.bin";
+    std::remove(path.c_str());
+    Snapshot loaded;
+    CHECK_FALSE(loaded.load(path));
+
+    Snapshot snapshot {"/var/tmp", {"TERMIC=1"}};
+    REQUIRE(snapshot.save(path));
+    REQUIRE(loaded.load(path));
+    CHECK(loaded.cwd == snapshot.cwd);
+    CHECK(loaded.environment == snapshot.environment);
+
+    // overwrite
+    snapshot.cwd = "/";
+    REQUIRE(snapshot.save(path));
+    REQUIRE(loaded.load(path));
+    CHECK(loaded.cwd == "/");
+
+    // not a snapshot
+    std::FILE* f = std::fopen(path.c_str(), "wb");
+    REQUIRE(f != nullptr);
+    std::fputs("export A=1\n", f);
+    std::fclose(f);
+    CHECK_FALSE(loaded.load(path));
+
+    std::remove(path.c_str());
+}
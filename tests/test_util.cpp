@@ -6,68 +6,194 @@
 #define CATCH_CONFIG_MAIN
 #include <catch2/catch.hpp>
 #include "utility.h"
+#include "unicode.h"
 #include <string>
 
 using std::string_view;
 using namespace xci::term;
-using namespace std::string_literals;
 
 
-TEST_CASE( "cseq_next_param/explicit", "[utility]" )
+TEST_CASE( "CseqParams/explicit", "[utility]" )
 {
-    auto params = "1;2"s;
-    string_view params_view = params;
-    bool res;
-    unsigned int p;
-    constexpr int dfl = -1;
-
-    p = dfl;
-    res = cseq_next_param(params_view, p);
-    CHECK(res);
-    CHECK(p == 1);
-    CHECK(params_view == "2");
-
-    p = dfl;
-    res = cseq_next_param(params_view, p);
-    CHECK(!res);
-    CHECK(p == 2);
+    CseqParams params;
+    constexpr unsigned dfl = -1;
+
+    params.parse("1;2");
+    CHECK(params.size() == 2);
+    CHECK(params.get(0, dfl) == 1);
+    CHECK(params.get(1, dfl) == 2);
+    CHECK(params.get(2, dfl) == dfl);
+    CHECK(params.marker() == 0);
+    CHECK(!params.overflow());
+    CHECK(!params.invalid());
+}
+
+
+TEST_CASE( "CseqParams/with_defaults", "[utility]" )
+{
+    CseqParams params;
+    constexpr unsigned dfl = -1;
+
+    params.parse(";1;1234;;");
+    CHECK(params.size() == 5);
+    CHECK(params.get(0, dfl) == dfl);
+    CHECK(params.get(1, dfl) == 1);
+    CHECK(params.get(2, dfl) == 1234);
+    CHECK(params.get(3, dfl) == dfl);
+    CHECK(params.get(4, dfl) == dfl);
+
+    params.parse("");
+    CHECK(params.empty());
+    CHECK(params.get(0, dfl) == dfl);
+
+    params.parse("0");
+    CHECK(params.get(0, dfl) == 0);
+}
+
+
+TEST_CASE( "CseqParams/sub_params", "[utility]" )
+{
+    CseqParams params;
+    constexpr unsigned dfl = -1;
+
+    params.parse("1;38:2::10:20:30;4:3");
+    REQUIRE(params.size() == 3);
+    CHECK(params.num_sub(0) == 0);
+    CHECK(params.get(1, dfl) == 38);
+    REQUIRE(params.num_sub(1) == 5);
+    CHECK(params.sub(1, 0, dfl) == 2);
+    CHECK(params.sub(1, 1, dfl) == dfl);
+    CHECK(params.sub(1, 2, dfl) == 10);
+    CHECK(params.sub(1, 3, dfl) == 20);
+    CHECK(params.sub(1, 4, dfl) == 30);
+    CHECK(params.sub(1, 5, dfl) == dfl);
+    CHECK(params.get(2, dfl) == 4);
+    CHECK(params.num_sub(2) == 1);
+    CHECK(params.sub(2, 0, dfl) == 3);
+    CHECK(fmt::format("{}", params) == "1;38:2::10:20:30;4:3");
+}
+
+
+TEST_CASE( "CseqParams/private_and_invalid", "[utility]" )
+{
+    CseqParams params;
+
+    params.parse("?1049;1");
+    CHECK(params.marker() == '?');
+    CHECK(params.size() == 2);
+    CHECK(params.get(0, 0) == 1049);
+    CHECK(!params.invalid());
+    CHECK(fmt::format("{}", params) == "?1049;1");
+
+    params.parse("1?2");
+    CHECK(params.invalid());
+}
+
+
+TEST_CASE( "CseqParams/overflow", "[utility]" )
+{
+    CseqParams params;
+
+    std::string many;
+    for (unsigned i = 0; i != 100; ++i)
+        many += "1;";
+    params.parse(many);
+    CHECK(params.overflow());
+    CHECK(params.size() == CseqParams::max_params);
+    CHECK(params.get(CseqParams::max_params - 1, 0) == 1);
+
+    params.parse("99999999999999999999");
+    CHECK(params.get(0, 0) == CseqParams::max_value);
+    CHECK(!params.overflow());
+}
+
+
+TEST_CASE( "repeat_char", "[utility]" )
+{
+    std::string out;
+    unsigned chars = 0;
+    auto append = [&](string_view chunk, unsigned n) {
+        out += chunk;
+        chars += n;
+    };
+
+    repeat_char("-", 3, append);
+    CHECK(out == "---");
+    CHECK(chars == 3);
+
+    out.clear(); chars = 0;
+    repeat_char("─", 1000, append);  // 3 bytes in UTF-8
+    CHECK(out.size() == 3000);
+    CHECK(chars == 1000);
+    CHECK(out.substr(2997) == "─");
+
+    out.clear(); chars = 0;
+    repeat_char("漢 ", 100, append);  // wide char with padding
+    CHECK(out.size() == 400);
+    CHECK(chars == 100);
+
+    out.clear(); chars = 0;
+    repeat_char("x", 0, append);
+    repeat_char("", 10, append);
+    CHECK(out.empty());
+    CHECK(chars == 0);
+}
+
+
+TEST_CASE( "ascii_prefix", "[unicode]" )
+{
+    CHECK(ascii_prefix("") == 0);
+    CHECK(ascii_prefix("abc") == 3);
+    std::string s(100, 'x');
+    CHECK(ascii_prefix(s) == 100);
+    for (size_t pos : {0, 7, 8, 15, 16, 17, 40, 99}) {
+        s[pos] = '\xC3';
+        CHECK(ascii_prefix(s) == pos);
+        s[pos] = 'x';
+    }
+}
+
+
+TEST_CASE( "utf8_decode", "[unicode]" )
+{
+    char32_t cp;
+    CHECK(utf8_decode("a", cp) == 1);
+    CHECK(cp == U'a');
+    CHECK(utf8_decode("é", cp) == 2);
+    CHECK(cp == U'é');
+    CHECK(utf8_decode("─x", cp) == 3);
+    CHECK(cp == U'─');
+    CHECK(utf8_decode("🐱", cp) == 4);
+    CHECK(cp == U'🐱');
+
+    // invalid: maximal subpart is consumed
+    CHECK(utf8_decode("\x80", cp) == 1);
+    CHECK(cp == utf8_invalid);
+    CHECK(utf8_decode("\xC0\xAF", cp) == 1);  // overlong
+    CHECK(cp == utf8_invalid);
+    CHECK(utf8_decode("\xE0\x80\xAF", cp) == 1);  // overlong
+    CHECK(utf8_decode("\xED\xA0\x80", cp) == 1);  // surrogate
+    CHECK(utf8_decode("\xF4\x90\x80\x80", cp) == 1);  // > U+10FFFF
+    CHECK(utf8_decode("\xE2\x94x", cp) == 2);  // truncated
+    CHECK(cp == utf8_invalid);
+    CHECK(utf8_decode("\xF0\x9F\x90", cp) == 3);  // truncated at end
+    CHECK(cp == utf8_invalid);
 }
 
 
-TEST_CASE( "cseq_next_param/with_defaults", "[utility]" )
+TEST_CASE( "char_width", "[unicode]" )
 {
-    auto params = ";1;1234;;"s;
-    string_view params_view = params;
-    bool res;
-    unsigned int p;
-    constexpr unsigned int dfl = -1;
-
-    p = dfl;
-    res = cseq_next_param(params_view, p);
-    CHECK(res);
-    CHECK(p == dfl);
-    CHECK(params_view == "1;1234;;");
-    
-    p = dfl;
-    res = cseq_next_param(params_view, p);
-    CHECK(res);
-    CHECK(p == 1);
-    CHECK(params_view == "1234;;");
-
-    p = dfl;
-    res = cseq_next_param(params_view, p);
-    CHECK(res);
-    CHECK(p == 1234);
-    CHECK(params_view == ";");
-
-    p = dfl;
-    res = cseq_next_param(params_view, p);
-    CHECK(res);
-    CHECK(p == dfl);
-    CHECK(params_view == "");
-
-    p = dfl;
-    res = cseq_next_param(params_view, p);
-    CHECK(!res);
-    CHECK(p == dfl);
+    CHECK(char_width(U'a') == 1);
+    CHECK(char_width(U'é') == 1);
+    CHECK(char_width(U'─') == 1);
+    CHECK(char_width(U'\u0301') == 0);  // combining acute accent
+    CHECK(char_width(U'\u200B') == 0);  // zero width space
+    CHECK(char_width(U'\u00AD') == 1);  // soft hyphen
+    CHECK(char_width(U'漢') == 2);
+    CHECK(char_width(U'ｱ') == 1);  // halfwidth katakana
+    CHECK(char_width(U'Ａ') == 2);  // fullwidth A
+    CHECK(char_width(U'🐱') == 2);
+    CHECK(char_width(U'\U0002A6D6') == 2);
+    CHECK(char_width(0x10FFFF) == 1);
+    CHECK(char_width(0x110000) == 1);
 }
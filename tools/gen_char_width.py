@@ -0,0 +1,81 @@
+#!/usr/bin/env python3
+#
+# Generates src/char_width_table.h - two-stage lookup table of character
+# cell widths (0 = combining / control / format, 1 = narrow, 2 = wide).
+#
+# Usage:
+#   ./gen_char_width.py > ../src/char_width_table.h
+#
+# The Unicode version is that of Python's unicodedata module.
+
+import unicodedata
+
+MAX_CP = 0x110000
+BLOCK = 256
+
+
+def width(cp):
+    if cp == 0x00AD:  # soft hyphen is visible
+        return 1
+    if 0x1160 <= cp <= 0x11FF or cp == 0x200B:  # Hangul Jamo vowels / finals, ZWSP
+        return 0
+    ch = chr(cp)
+    category = unicodedata.category(ch)
+    if category in ('Mn', 'Me', 'Cf', 'Cc'):
+        return 0
+    if category != 'Cn' and unicodedata.east_asian_width(ch) in ('W', 'F'):
+        return 2
+    # unassigned CJK (planes 2 and 3) are reserved for wide ideographs
+    if 0x20000 <= cp <= 0x2FFFD or 0x30000 <= cp <= 0x3FFFD:
+        return 2
+    return 1
+
+
+def main():
+    blocks = []
+    block_index = {}
+    stage1 = []
+    for base in range(0, MAX_CP, BLOCK):
+        packed = bytearray(BLOCK // 4)
+        for i in range(BLOCK):
+            packed[i // 4] |= width(base + i) << (2 * (i % 4))
+        packed = bytes(packed)
+        if packed not in block_index:
+            block_index[packed] = len(blocks)
+            blocks.append(packed)
+        stage1.append(block_index[packed])
+    assert len(blocks) <= 256
+
+    print(f'''// char_width_table.h generated by tools/gen_char_width.py
+// This file is part of Termic project <https://github.com/rbrich/termic>
+// Copyright 2026 Radek Brich
+// Licensed under the Apache License, Version 2.0 (see LICENSE file)
+//
+// Unicode {unicodedata.unidata_version} - do not edit, regenerate.
+
+#ifndef XCITERM_CHAR_WIDTH_TABLE_H
+#define XCITERM_CHAR_WIDTH_TABLE_H
+
+#include <cstdint>
+
+namespace xci::term::char_width_table {{
+
+// Stage 1: code point >> 8 -> block number
+inline constexpr uint8_t stage1[{len(stage1)}] = {{''')
+    for i in range(0, len(stage1), 24):
+        print('    ' + ','.join(str(x) for x in stage1[i:i + 24]) + ',')
+    print(f'''}};
+
+// Stage 2: blocks of 256 widths, 2 bits each (little-endian in byte)
+inline constexpr uint8_t stage2[{len(blocks)}][{BLOCK // 4}] = {{''')
+    for b in blocks:
+        print('    {' + ','.join(f'0x{x:02x}' for x in b) + '},')
+    print('''};
+
+} // namespace xci::term::char_width_table
+
+#endif // XCITERM_CHAR_WIDTH_TABLE_H''')
+
+
+if __name__ == '__main__':
+    main()
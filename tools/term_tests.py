@@ -1,5 +1,8 @@
 #!/usr/bin/env python3
 
+import shutil
+import sys
+
 # Replace existing text with different attributes
 print("\033[31;1mred green blue normal red\033[21D"
       "\033[32mgreen \033[34mblue \033[mnormal")
@@ -18,3 +21,26 @@ print('       ^ up to here: cyan bg')
 
 print('12345678\033[45m\033[2K\033[0m')
 print('^ whole line: magenta bg')
+
+# Erase / repeat character
+print('123456789\033[8D\033[3X')
+print('1   56789 (ECH 3)')
+
+print('-\033[9b (REP 9)')
+print('---------- (REP 9)')
+
+# Wide, combining and invalid characters
+print('漢字|abc (wide)')
+print('1234|abc')
+print('é|x (combining mark on e)')
+print('é|x')
+print('漢́|x (on wide char)')
+print('漢|x')
+sys.stdout.flush()
+sys.stdout.buffer.write(b'a\xffb\xe2\x94|x (invalid)\n')
+print('a�b�|x')
+
+# Wide character in the last column wraps whole
+cols = shutil.get_terminal_size().columns
+print('.' * (cols - 1) + '漢|x')
+print('漢|x (wrapped)')